@@ -0,0 +1,511 @@
+/*
+ *      braceindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Index of the matching braces of a document.
+ *
+ * Like Scintilla's brace matching, a brace only matches braces of the same style, so braces in
+ * comments and strings don't pair with code braces. The braces are kept in an array sorted by
+ * position, with the index of their matching brace, so a match is found with a binary
+ * search. The index is built on the first lookup in idle time slices, styling the document
+ * ahead a chunk at a time as needed.
+ *
+ * Edits which insert or delete no braces only move the braces after them. Like Scintilla's
+ * line partitioning, the move is kept as a pending step which applies to the braces from an
+ * index on, so consecutive edits only update the braces between them. Other edits, and
+ * style changes of indexed braces, drop the braces after the change, which are indexed again
+ * on the next lookup. Until the index covers a brace, lookups fail and callers fall back to
+ * Scintilla.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "braceindex.h"
+
+#include "sciwrappers.h"
+#include "utils.h"
+
+#include <string.h>
+
+
+/* time for building the index per main loop iteration, in microseconds */
+#define BUILD_SLICE_USEC 8000
+#define BUILD_CHUNK_SIZE (64 * 1024)
+/* the brace kinds are (), [], {} and <> */
+#define N_BRACE_KINDS 4
+#define N_STACKS (256 * N_BRACE_KINDS)
+
+
+typedef struct BraceEntry
+{
+	gint	pos;		/* without the pending step, see entry_pos() */
+	gint	match;		/* index of the matching brace in entries, -1 if none (yet) */
+	guint8	style;
+	gchar	brace;
+}
+BraceEntry;
+
+struct BraceIndex
+{
+	ScintillaObject	*sci;
+	GArray			*entries;		/* BraceEntry, sorted by position */
+	/* the indexes of the unmatched opening braces in entries for each style and brace kind */
+	GArray			*stacks[N_STACKS];
+	gint			 valid_end;		/* the braces before this position are indexed */
+	/* the entries from step_index on are step_delta before their actual position */
+	guint			 step_index;
+	gint			 step_delta;
+	guint			 build_source;
+	gchar			*buffer;		/* styled text of a chunk */
+};
+
+
+/* Returns the kind of brace and whether it's an opening brace, or -1 for other chars */
+static inline gint get_brace_kind(gchar c, gboolean *opening)
+{
+	*opening = TRUE;
+	switch (c)
+	{
+		case ')': *opening = FALSE; /* fall through */
+		case '(': return 0;
+		case ']': *opening = FALSE; /* fall through */
+		case '[': return 1;
+		case '}': *opening = FALSE; /* fall through */
+		case '{': return 2;
+		case '>': *opening = FALSE; /* fall through */
+		case '<': return 3;
+	}
+	return -1;
+}
+
+
+static inline gint entry_pos(BraceIndex *index, guint i)
+{
+	gint pos = g_array_index(index->entries, BraceEntry, i).pos;
+
+	return i < index->step_index ? pos : pos + index->step_delta;
+}
+
+
+/* Returns the index of the first entry not before pos */
+static guint lower_bound(BraceIndex *index, gint pos)
+{
+	guint lo = 0, hi = index->entries->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (entry_pos(index, mid) < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+static void push_brace(BraceIndex *index, guint key, guint entry)
+{
+	if (index->stacks[key] == NULL)
+		index->stacks[key] = g_array_new(FALSE, FALSE, sizeof(guint));
+	g_array_append_val(index->stacks[key], entry);
+}
+
+
+static void add_brace(BraceIndex *index, gint pos, gchar brace, guint8 style)
+{
+	BraceEntry entry;
+	gboolean opening;
+	guint key = style * N_BRACE_KINDS + get_brace_kind(brace, &opening);
+
+	/* new entries are after the step */
+	entry.pos = pos - index->step_delta;
+	entry.match = -1;
+	entry.style = style;
+	entry.brace = brace;
+
+	if (opening)
+		push_brace(index, key, index->entries->len);
+	else if (index->stacks[key] != NULL && index->stacks[key]->len > 0)
+	{
+		GArray *stack = index->stacks[key];
+		guint i = g_array_index(stack, guint, stack->len - 1);
+		BraceEntry *open = &g_array_index(index->entries, BraceEntry, i);
+
+		g_array_set_size(stack, stack->len - 1);
+		open->match = (gint) index->entries->len;
+		entry.match = (gint) i;
+	}
+	g_array_append_val(index->entries, entry);
+}
+
+
+static void scan_range(BraceIndex *index, gint start, gint end)
+{
+	struct Sci_TextRange tr;
+	gint i;
+
+	tr.chrg.cpMin = start;
+	tr.chrg.cpMax = end;
+	tr.lpstrText = index->buffer;
+	scintilla_send_message(index->sci, SCI_GETSTYLEDTEXT, 0, (sptr_t) &tr);
+
+	for (i = 0; i < end - start; i++)
+	{
+		gchar c = index->buffer[2 * i];
+
+		switch (c)
+		{
+			case '(': case ')': case '[': case ']':
+			case '{': case '}': case '<': case '>':
+				add_brace(index, start + i, c, (guint8) index->buffer[2 * i + 1]);
+				break;
+		}
+	}
+	index->valid_end = end;
+}
+
+
+static gboolean build_idle(gpointer data)
+{
+	BraceIndex *index = data;
+	ScintillaObject *sci = index->sci;
+	gint64 deadline = g_get_monotonic_time() + BUILD_SLICE_USEC;
+	gint length = sci_get_length(sci);
+
+	while (index->valid_end < length)
+	{
+		gint end = MIN(index->valid_end + BUILD_CHUNK_SIZE, length);
+		gint end_styled = sci_get_end_styled(sci);
+
+		/* braces only match braces of the same style, so style ahead. Style up to the end of
+		 * the line, but at most a chunk per step, as a line may be megabytes long. */
+		if (end_styled < end)
+		{
+			gint line_end = sci_get_line_end_position(sci, sci_get_line_from_position(sci, end));
+
+			sci_colourise(sci, end_styled, MIN(line_end, end_styled + BUILD_CHUNK_SIZE));
+			if (sci_get_end_styled(sci) <= end_styled)
+				break;
+			end = MIN(end, sci_get_end_styled(sci));
+		}
+
+		if (end > index->valid_end)
+			scan_range(index, index->valid_end, end);
+		if (g_get_monotonic_time() >= deadline)
+			return G_SOURCE_CONTINUE;
+	}
+
+	index->build_source = 0;
+	return G_SOURCE_REMOVE;
+}
+
+
+static void start_build(BraceIndex *index)
+{
+	if (index->build_source == 0)
+		index->build_source = g_idle_add(build_idle, index);
+}
+
+
+static gint compare_indexes(gconstpointer a, gconstpointer b)
+{
+	guint ia = *(const guint *) a, ib = *(const guint *) b;
+
+	return ia < ib ? -1 : ia > ib;
+}
+
+
+/* Drops the braces from pos on. Only the dropped braces are looked at, so the cost is
+ * proportional to what is indexed again. */
+static void invalidate(BraceIndex *index, gint pos)
+{
+	guint first = lower_bound(index, pos);
+	GArray *reopened;
+	guint i, k;
+
+	if (pos >= index->valid_end)
+		return;
+
+	/* the opening braces matched by dropped closing braces are unmatched again */
+	reopened = g_array_new(FALSE, FALSE, sizeof(guint));
+	for (i = first; i < index->entries->len; i++)
+	{
+		const BraceEntry *entry = &g_array_index(index->entries, BraceEntry, i);
+		gboolean opening;
+
+		get_brace_kind(entry->brace, &opening);
+		if (! opening && entry->match >= 0 && (guint) entry->match < first)
+		{
+			guint open = (guint) entry->match;
+
+			g_array_index(index->entries, BraceEntry, open).match = -1;
+			g_array_append_val(reopened, open);
+		}
+	}
+	g_array_set_size(index->entries, first);
+	index->valid_end = pos;
+	if (index->step_index >= first)
+	{
+		index->step_index = first;
+		index->step_delta = 0;
+	}
+
+	/* the dropped braces are on top of the stacks */
+	for (k = 0; k < N_STACKS; k++)
+	{
+		GArray *stack = index->stacks[k];
+
+		while (stack != NULL && stack->len > 0 &&
+			g_array_index(stack, guint, stack->len - 1) >= first)
+		{
+			g_array_set_size(stack, stack->len - 1);
+		}
+	}
+	/* put the reopened braces back in position order */
+	g_array_sort(reopened, compare_indexes);
+	for (i = 0; i < reopened->len; i++)
+	{
+		guint open = g_array_index(reopened, guint, i);
+		const BraceEntry *entry = &g_array_index(index->entries, BraceEntry, open);
+		gboolean opening;
+		guint key = entry->style * N_BRACE_KINDS + get_brace_kind(entry->brace, &opening);
+		GArray *stack;
+		guint lo, hi;
+
+		push_brace(index, key, open);
+		stack = index->stacks[key];
+		lo = 0;
+		hi = stack->len - 1;
+		while (lo < hi)
+		{
+			guint mid = lo + (hi - lo) / 2;
+
+			if (g_array_index(stack, guint, mid) < open)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		memmove(&g_array_index(stack, guint, lo + 1), &g_array_index(stack, guint, lo),
+			(stack->len - 1 - lo) * sizeof(guint));
+		g_array_index(stack, guint, lo) = open;
+	}
+	g_array_free(reopened, TRUE);
+}
+
+
+/* Moves the pending step to the entry at first, updating the entries in between */
+static void move_step(BraceIndex *index, guint first)
+{
+	guint i;
+
+	for (i = index->step_index; i < first; i++)
+		g_array_index(index->entries, BraceEntry, i).pos += index->step_delta;
+	for (i = first; i < index->step_index; i++)
+		g_array_index(index->entries, BraceEntry, i).pos -= index->step_delta;
+	index->step_index = first;
+}
+
+
+/* Moves the braces from pos on by delta, for an edit which inserted or deleted no braces */
+static void shift(BraceIndex *index, gint pos, gint delta)
+{
+	guint first = lower_bound(index, pos);
+
+	if (index->step_delta == 0)
+		index->step_index = first;
+	else if (first < index->step_index &&
+		index->step_index - first > index->entries->len - index->step_index)
+	{
+		/* applying the step to the entries after it is less work than moving it back */
+		move_step(index, index->entries->len);
+		index->step_index = first;
+		index->step_delta = 0;
+	}
+	else
+		move_step(index, first);
+
+	index->step_delta += delta;
+	index->valid_end += delta;
+}
+
+
+/* Whether any indexed brace is inside the range */
+static gboolean has_braces(BraceIndex *index, gint start, gint end)
+{
+	guint i = lower_bound(index, start);
+
+	return i < index->entries->len && entry_pos(index, i) < end;
+}
+
+
+/* Finds the opening brace matching the closing brace at valid_end, which is the common case
+ * right after typing it */
+static gint find_opening_brace(BraceIndex *index, gchar brace, guint8 style)
+{
+	gchar open = utils_brace_opposite(brace);
+	guint i = index->entries->len;
+
+	while (i > 0)
+	{
+		const BraceEntry *entry = &g_array_index(index->entries, BraceEntry, --i);
+
+		if (entry->style != style)
+			continue;
+		if (entry->brace == open && entry->match < 0)
+			return entry_pos(index, i);
+		if (entry->brace == brace)
+		{
+			/* skip the matched pair, or there's no opening brace left */
+			if (entry->match < 0)
+				return -1;
+			i = (guint) entry->match;
+		}
+	}
+	return -1;
+}
+
+
+BraceIndex *braceindex_new(ScintillaObject *sci)
+{
+	BraceIndex *index = g_new0(BraceIndex, 1);
+
+	index->sci = sci;
+	index->entries = g_array_new(FALSE, FALSE, sizeof(BraceEntry));
+	index->buffer = g_malloc(2 * BUILD_CHUNK_SIZE + 2);
+	return index;
+}
+
+
+void braceindex_free(BraceIndex *index)
+{
+	guint i;
+
+	if (index == NULL)
+		return;
+
+	if (index->build_source != 0)
+		g_source_remove(index->build_source);
+	for (i = 0; i < N_STACKS; i++)
+	{
+		if (index->stacks[i] != NULL)
+			g_array_free(index->stacks[i], TRUE);
+	}
+	g_array_free(index->entries, TRUE);
+	g_free(index->buffer);
+	g_free(index);
+}
+
+
+/* Updates the index for an SCN_MODIFIED notification */
+void braceindex_update(BraceIndex *index, const SCNotification *nt)
+{
+	gint pos = (gint) nt->position;
+	gint len = (gint) nt->length;
+
+	/* changes after the indexed part only matter once it's indexed */
+	if (pos >= index->valid_end)
+		return;
+
+	if (nt->modificationType & SC_MOD_INSERTTEXT)
+	{
+		gint i;
+
+		for (i = 0; nt->text != NULL && i < len; i++)
+		{
+			gboolean opening;
+
+			if (get_brace_kind(nt->text[i], &opening) >= 0)
+				break;
+		}
+		if (nt->text != NULL && i == len)
+			shift(index, pos, len);
+		else
+			invalidate(index, pos);
+	}
+	else if (nt->modificationType & SC_MOD_DELETETEXT)
+	{
+		/* the indexed positions are still the ones before the deletion */
+		if (pos + len <= index->valid_end && ! has_braces(index, pos, pos + len))
+			shift(index, pos + len, -len);
+		else
+			invalidate(index, pos);
+	}
+	else if (nt->modificationType & SC_MOD_CHANGESTYLE)
+	{
+		/* lexing new text changes its styles, which only matters for braces */
+		if (has_braces(index, pos, pos + len))
+			invalidate(index, pos);
+	}
+}
+
+
+/* Looks up the brace matching the brace at pos, like SCI_BRACEMATCH. Returns FALSE if the
+ * index doesn't cover it yet, and starts indexing in the background. */
+gboolean braceindex_find_match(BraceIndex *index, gint pos, gint *match)
+{
+	const BraceEntry *entry;
+	guint i;
+
+	if (pos == index->valid_end && pos < sci_get_length(index->sci))
+	{
+		gchar c = sci_get_char_at(index->sci, pos);
+		gboolean opening;
+
+		if (get_brace_kind(c, &opening) >= 0 && ! opening)
+		{
+			if (sci_get_end_styled(index->sci) <= pos)
+				sci_colourise(index->sci, pos, pos + 1);
+			*match = find_opening_brace(index, c, (guint8) sci_get_style_at(index->sci, pos));
+			return TRUE;
+		}
+	}
+	if (pos < 0 || pos >= index->valid_end)
+	{
+		start_build(index);
+		return FALSE;
+	}
+
+	i = lower_bound(index, pos);
+	if (i >= index->entries->len || entry_pos(index, i) != pos)
+	{
+		*match = -1;
+		return TRUE;
+	}
+
+	entry = &g_array_index(index->entries, BraceEntry, i);
+	if (entry->match < 0 && index->valid_end < sci_get_length(index->sci))
+	{
+		gboolean opening;
+
+		/* an opening brace may be matched after the indexed part */
+		get_brace_kind(entry->brace, &opening);
+		if (opening)
+		{
+			start_build(index);
+			return FALSE;
+		}
+	}
+	*match = entry->match < 0 ? -1 : entry_pos(index, (guint) entry->match);
+	return TRUE;
+}
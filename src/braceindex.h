@@ -0,0 +1,43 @@
+/*
+ *      braceindex.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GEANY_BRACEINDEX_H
+#define GEANY_BRACEINDEX_H 1
+
+#include "gtkcompat.h" /* Needed by ScintillaWidget.h */
+#include "Scintilla.h" /* Needed by ScintillaWidget.h */
+#include "ScintillaWidget.h" /* for ScintillaObject */
+
+G_BEGIN_DECLS
+
+typedef struct BraceIndex BraceIndex;
+
+
+BraceIndex *braceindex_new(ScintillaObject *sci);
+
+void braceindex_free(BraceIndex *index);
+
+void braceindex_update(BraceIndex *index, const SCNotification *nt);
+
+gboolean braceindex_find_match(BraceIndex *index, gint pos, gint *match);
+
+G_END_DECLS
+
+#endif /* GEANY_BRACEINDEX_H */
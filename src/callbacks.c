@@ -108,7 +108,7 @@ void on_save1_activate(GtkMenuItem *menuitem, gpointer user_data)
 
 	if (doc != NULL)
 	{
-		document_save_file(doc, ui_prefs.allow_always_save);
+		document_save_file_async(doc, ui_prefs.allow_always_save);
 	}
 }
 
@@ -690,6 +690,15 @@ static void on_set_file_readonly1_toggled(GtkCheckMenuItem *checkmenuitem, gpoin
 		GeanyDocument *doc = document_get_current();
 		g_return_if_fail(doc != NULL);
 
+		/* a half loaded file must not be edited or saved */
+		if (doc->priv->large_file_loader != NULL)
+		{
+			ignore_callback = TRUE;
+			gtk_check_menu_item_set_active(checkmenuitem, doc->readonly);
+			ignore_callback = FALSE;
+			ui_set_statusbar(TRUE, _("%s is still being loaded."), DOC_FILENAME(doc));
+			return;
+		}
 		doc->readonly = ! doc->readonly;
 		sci_set_readonly(doc->editor->sci, doc->readonly);
 		ui_update_tab_status(doc);
@@ -697,6 +706,17 @@ static void on_set_file_readonly1_toggled(GtkCheckMenuItem *checkmenuitem, gpoin
 	}
 }
 
+static void on_set_file_large1_toggled(GtkCheckMenuItem *checkmenuitem, gpointer user_data)
+{
+	if (! ignore_callback)
+	{
+		GeanyDocument *doc = document_get_current();
+		g_return_if_fail(doc != NULL);
+
+		document_set_large_file(doc, gtk_check_menu_item_get_active(checkmenuitem));
+	}
+}
+
 static void on_use_auto_indentation1_toggled(GtkCheckMenuItem *checkmenuitem, gpointer user_data)
 {
 	if (! ignore_callback)
@@ -1553,8 +1573,7 @@ static void on_goto1_activate(GtkMenuItem *menuitem, gpointer user_data)
 {
 	GtkWidget *next_message = ui_lookup_widget(main_widgets.window, "next_message1");
 	GtkWidget *previous_message = ui_lookup_widget(main_widgets.window, "previous_message1");
-	gboolean have_messages = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(msgwindow.store_msg),
-			NULL) > 0;
+	gboolean have_messages = msgwin_msg_count() > 0;
 	gtk_widget_set_sensitive(next_message, have_messages);
 	gtk_widget_set_sensitive(previous_message, have_messages);
 }
@@ -1204,7 +1204,7 @@ void dialogs_show_file_properties(GeanyDocument *doc)
 {
 	GtkWidget *dialog, *label, *image, *check;
 	gchar *file_size, *title, *base_name, *time_changed, *time_modified, *time_accessed;
-	gchar *short_name;
+	gchar *short_name, *undo_memory;
 #ifdef HAVE_SYS_TYPES_H
 	GStatBuf st;
 	off_t filesize;
@@ -1308,6 +1308,11 @@ void dialogs_show_file_properties(GeanyDocument *doc)
 	label = ui_lookup_widget(dialog, "file_accessed_label");
 	gtk_label_set_text(GTK_LABEL(label), time_accessed);
 
+	label = ui_lookup_widget(dialog, "file_undo_memory_label");
+	undo_memory = utils_make_human_readable_str(document_get_undo_memory(doc), 1, 0);
+	gtk_label_set_text(GTK_LABEL(label), undo_memory);
+	g_free(undo_memory);
+
 	/* permissions */
 	check = ui_lookup_widget(dialog, "file_perm_owner_r_check");
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check), mode & S_IRUSR);
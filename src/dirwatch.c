@@ -0,0 +1,256 @@
+/*
+ *      dirwatch.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Shared directory watcher for open documents.
+ *
+ * Instead of one monitor per document, one GFileMonitor is kept per directory containing open
+ * documents. Events only mark the affected documents as needing a disk check, so
+ * document_check_disk_status() can skip the stat() for all other documents.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "dirwatch.h"
+
+#include "documentprivate.h"
+#include "searchindex.h"
+#include "utils.h"
+
+#include <gio/gio.h>
+
+typedef struct DirWatch
+{
+	GFileMonitor	*monitor;
+	/* base name -> GSList of documents, usually only one. The lists are freed manually. */
+	GHashTable		*documents;
+	guint			 count;
+}
+DirWatch;
+
+/* locale encoded directory path -> DirWatch */
+static GHashTable *dir_watches = NULL;
+static guint check_current_source = 0;
+
+static gboolean check_current_document_idle(G_GNUC_UNUSED gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+
+	check_current_source = 0;
+
+	if (doc != NULL && doc->priv->disk_dirty)
+		document_check_disk_status(doc, FALSE);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void mark_dirty(DirWatch *watch, GFile *file)
+{
+	gchar *base_name;
+	GSList *node;
+
+	if (file == NULL)
+		return;
+
+	base_name = g_file_get_basename(file);
+
+	for (node = g_hash_table_lookup(watch->documents, base_name); node; node = node->next)
+	{
+		GeanyDocument *doc = node->data;
+
+		doc->priv->disk_dirty = TRUE;
+
+		/* only the current document is checked right away, others when switched to */
+		if (doc == document_get_current() && check_current_source == 0)
+			check_current_source = g_idle_add(check_current_document_idle, NULL);
+	}
+	g_free(base_name);
+}
+
+/* files that aren't open can change too, so the project's search index is told about all */
+static void index_changed(GFile *file)
+{
+	gchar *path;
+
+	if (file == NULL)
+		return;
+
+	path = g_file_get_path(file);
+	searchindex_file_changed(path);
+	g_free(path);
+}
+
+static void on_dir_changed(G_GNUC_UNUSED GFileMonitor *monitor, GFile *file, GFile *other_file,
+		GFileMonitorEvent event, gpointer data)
+{
+	DirWatch *watch = data;
+
+	switch (event)
+	{
+		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		case G_FILE_MONITOR_EVENT_DELETED:
+		case G_FILE_MONITOR_EVENT_CREATED:
+		case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+		case G_FILE_MONITOR_EVENT_MOVED:
+			mark_dirty(watch, file);
+			mark_dirty(watch, other_file);
+			index_changed(file);
+			index_changed(other_file);
+			break;
+		default:
+			break;
+	}
+}
+
+static void free_document_list(G_GNUC_UNUSED gpointer key, gpointer list,
+		G_GNUC_UNUSED gpointer data)
+{
+	g_slist_free(list);
+}
+
+static void dir_watch_free(DirWatch *watch)
+{
+	if (watch->monitor != NULL)
+	{
+		g_signal_handlers_disconnect_by_func(watch->monitor, on_dir_changed, watch);
+		g_file_monitor_cancel(watch->monitor);
+		g_object_unref(watch->monitor);
+	}
+	g_hash_table_foreach(watch->documents, free_document_list, NULL);
+	g_hash_table_destroy(watch->documents);
+	g_free(watch);
+}
+
+static DirWatch *dir_watch_new(const gchar *dir_path)
+{
+	DirWatch *watch;
+	GFile *dir = g_file_new_for_path(dir_path);
+	GFileMonitor *monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_SEND_MOVED, NULL, NULL);
+
+	g_object_unref(dir);
+	if (monitor == NULL)
+		return NULL;
+
+	watch = g_new0(DirWatch, 1);
+	watch->monitor = monitor;
+	watch->documents = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	g_signal_connect(monitor, "changed", G_CALLBACK(on_dir_changed), watch);
+
+	return watch;
+}
+
+/* Starts watching the directory of the document's file, if it isn't watched already.
+ * Falls back to polling in document_check_disk_status() if the directory can't be watched. */
+void dirwatch_add_document(GeanyDocument *doc)
+{
+	DirWatch *watch;
+	gchar *dir_path, *base_name;
+	GSList *list;
+
+	g_return_if_fail(DOC_VALID(doc));
+
+	dirwatch_remove_document(doc);
+
+	if (doc->real_path == NULL || doc->priv->is_remote)
+		return;
+
+	if (dir_watches == NULL)
+	{
+		dir_watches = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+				(GDestroyNotify) dir_watch_free);
+	}
+
+	dir_path = g_path_get_dirname(doc->real_path);
+	watch = g_hash_table_lookup(dir_watches, dir_path);
+	if (watch == NULL)
+	{
+		watch = dir_watch_new(dir_path);
+		if (watch == NULL)
+		{
+			g_free(dir_path);
+			return;
+		}
+		g_hash_table_insert(dir_watches, dir_path, watch);
+	}
+	else
+		g_free(dir_path);
+
+	base_name = g_path_get_basename(doc->real_path);
+	list = g_hash_table_lookup(watch->documents, base_name);
+	/* takes ownership of base_name, or frees it if it's already there */
+	g_hash_table_insert(watch->documents, base_name, g_slist_prepend(list, doc));
+	watch->count++;
+
+	/* keep the path as real_path can be reset before the document is removed */
+	doc->priv->watched_path = g_strdup(doc->real_path);
+	doc->priv->disk_dirty = FALSE;
+}
+
+void dirwatch_remove_document(GeanyDocument *doc)
+{
+	DirWatch *watch;
+	gchar *dir_path, *base_name;
+	GSList *list;
+
+	g_return_if_fail(doc != NULL);
+
+	if (doc->priv->watched_path == NULL)
+		return;
+
+	dir_path = g_path_get_dirname(doc->priv->watched_path);
+	base_name = g_path_get_basename(doc->priv->watched_path);
+
+	watch = dir_watches != NULL ? g_hash_table_lookup(dir_watches, dir_path) : NULL;
+	if (watch != NULL)
+	{
+		list = g_slist_remove(g_hash_table_lookup(watch->documents, base_name), doc);
+		if (list != NULL)
+			g_hash_table_insert(watch->documents, g_strdup(base_name), list);
+		else
+			g_hash_table_remove(watch->documents, base_name);
+
+		if (--watch->count == 0)
+			g_hash_table_remove(dir_watches, dir_path);
+	}
+	g_free(dir_path);
+	g_free(base_name);
+	SETPTR(doc->priv->watched_path, NULL);
+}
+
+gboolean dirwatch_is_watching(GeanyDocument *doc)
+{
+	return doc->priv->watched_path != NULL;
+}
+
+void dirwatch_finalize(void)
+{
+	if (check_current_source != 0)
+	{
+		g_source_remove(check_current_source);
+		check_current_source = 0;
+	}
+	if (dir_watches != NULL)
+	{
+		g_hash_table_destroy(dir_watches);
+		dir_watches = NULL;
+	}
+}
@@ -31,9 +31,11 @@
 #include "document.h"
 
 #include "app.h"
+#include "braceindex.h"
 #include "callbacks.h" /* for ignore_callback */
 #include "consider.h"
 #include "dialogs.h"
+#include "dirwatch.h"
 #include "documentprivate.h"
 #include "encodings.h"
 #include "encodingsprivate.h"
@@ -55,6 +57,7 @@
 #include "utils.h"
 #include "vte.h"
 #include "win32.h"
+#include "wordindex.h"
 
 #include "gtkcompat.h"
 
@@ -119,6 +122,9 @@ static GtkWidget* document_show_message(GeanyDocument *doc, GtkMessageType msgty
 	const gchar *btn_3, GtkResponseType response_3,
 	const gchar *extra_text, const gchar *format, ...) G_GNUC_PRINTF(11, 12);
 static void document_remove_from_ordered_list(GeanyDocument *doc);
+static void large_file_loader_cancel(GeanyDocument *doc);
+static void queue_undo_memory_check(void);
+static void search_bar_state_clear(void);
 
 /**
  * Finds a document whose @c real_path field matches the given filename.
@@ -377,6 +383,9 @@ void document_finalize(void)
 {
 	guint i;
 
+	dirwatch_finalize();
+	search_bar_state_clear();
+
 	for (i = 0; i < documents_array->len; i++)
 		g_free(documents[i]);
 	g_ptr_array_free(documents_array, TRUE);
@@ -536,6 +545,7 @@ static void document_stop_file_monitoring(GeanyDocument *doc)
 		g_object_unref(doc->priv->monitor);
 		doc->priv->monitor = NULL;
 	}
+	dirwatch_remove_document(doc);
 }
 
 static void monitor_file_setup(GeanyDocument *doc)
@@ -566,6 +576,11 @@ static void monitor_file_setup(GeanyDocument *doc)
 			g_object_unref(file);
 		}
 		g_free(locale_filename);
+#else
+		if (file_prefs.use_directory_monitoring && file_prefs.disk_check_timeout > 0)
+			dirwatch_add_document(doc);
+		else
+			dirwatch_remove_document(doc);
 #endif
 	}
 	doc->priv->file_disk_status = FILE_OK;
@@ -684,9 +699,14 @@ static gboolean remove_page(guint page_num)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	/* wait for any background save so the changed state is up to date */
+	document_finish_async_save(doc);
+
 	if (doc->changed && ! dialogs_show_unsaved_file(doc, NULL))
 		return FALSE;
 
+	large_file_loader_cancel(doc);
+
 	/* tell any plugins that the document is about to be closed */
 	g_signal_emit_by_name(geany_object, "document-close", doc);
 
@@ -727,6 +747,10 @@ static gboolean remove_page(guint page_num)
 	if (doc->priv->tag_tree)
 		gtk_widget_destroy(doc->priv->tag_tree);
 
+	wordindex_free(doc->priv->word_index);
+	braceindex_free(doc->priv->brace_index);
+	if (doc->priv->fold_all_source != 0)
+		g_source_remove(doc->priv->fold_all_source);
 	editor_destroy(doc->editor);
 	doc->editor = NULL; /* needs to be NULL for document_undo_clear() call below */
 
@@ -999,29 +1023,39 @@ typedef struct
 	gchar		*enc;
 	gboolean	 bom;
 	time_t		 mtime;	/* modification time, read by stat::st_mtime */
+	goffset		 size;	/* size of the file on disk */
 	gboolean	 readonly;
 } FileData;
 
-static gboolean get_mtime(const gchar *locale_filename, time_t *time)
+/* Doesn't touch the UI so it can be used from worker threads. Returns the error message
+ * or NULL on success. */
+static gchar *get_mtime_and_size(const gchar *locale_filename, time_t *time, goffset *size)
 {
 	GError *error = NULL;
-	const gchar *err_msg = NULL;
+	gchar *err_msg = NULL;
 
 	if (USE_GIO_FILE_OPERATIONS)
 	{
 		GFile *file = g_file_new_for_path(locale_filename);
-		GFileInfo *info = g_file_query_info(file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE, NULL, &error);
+		GFileInfo *info = g_file_query_info(file,
+			G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_STANDARD_SIZE,
+			G_FILE_QUERY_INFO_NONE, NULL, &error);
 
 		if (info)
 		{
 			GTimeVal timeval;
 
 			g_file_info_get_modification_time(info, &timeval);
-			g_object_unref(info);
 			*time = timeval.tv_sec;
+			if (size != NULL)
+				*size = g_file_info_get_size(info);
+			g_object_unref(info);
 		}
 		else if (error)
-			err_msg = error->message;
+		{
+			err_msg = g_strdup(error->message);
+			g_error_free(error);
+		}
 
 		g_object_unref(file);
 	}
@@ -1030,29 +1064,44 @@ static gboolean get_mtime(const gchar *locale_filename, time_t *time)
 		GStatBuf st;
 
 		if (g_stat(locale_filename, &st) == 0)
+		{
 			*time = st.st_mtime;
+			if (size != NULL)
+				*size = st.st_size;
+		}
 		else
-			err_msg = g_strerror(errno);
+			err_msg = g_strdup(g_strerror(errno));
 	}
 
-	if (err_msg)
-	{
-		gchar *utf8_filename = utils_get_utf8_from_locale(locale_filename);
+	return err_msg;
+}
 
-		ui_set_statusbar(TRUE, _("Could not open file %s (%s)"),
-			utf8_filename, err_msg);
-		g_free(utf8_filename);
-	}
+static void show_open_error(const gchar *locale_filename, const gchar *err_msg)
+{
+	gchar *utf8_filename = utils_get_utf8_from_locale(locale_filename);
 
-	if (error)
-		g_error_free(error);
+	ui_set_statusbar(TRUE, _("Could not open file %s (%s)"), utf8_filename, err_msg);
+	g_free(utf8_filename);
+}
+
+static gboolean get_mtime(const gchar *locale_filename, time_t *time)
+{
+	gchar *err_msg = get_mtime_and_size(locale_filename, time, NULL);
 
-	return err_msg == NULL;
+	if (err_msg)
+	{
+		show_open_error(locale_filename, err_msg);
+		g_free(err_msg);
+		return FALSE;
+	}
+	return TRUE;
 }
 
-/* loads textfile data, verifies and converts to forced_enc or UTF-8. Also handles BOM. */
-static gboolean load_text_file(const gchar *locale_filename, const gchar *display_filename,
-	FileData *filedata, const gchar *forced_enc)
+/* Reads textfile data, verifies and converts to forced_enc or UTF-8. Also handles BOM.
+ * Doesn't touch the UI so it can be used from worker threads. On failure the message to
+ * show is stored in err_msg, and open_error tells whether it's about accessing the file. */
+static gboolean read_text_file(const gchar *locale_filename, const gchar *display_filename,
+	FileData *filedata, const gchar *forced_enc, gchar **err_msg, gboolean *open_error)
 {
 	GError *err = NULL;
 
@@ -1060,10 +1109,16 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 	filedata->len = 0;
 	filedata->enc = NULL;
 	filedata->bom = FALSE;
+	filedata->size = 0;
 	filedata->readonly = FALSE;
+	*open_error = FALSE;
 
-	if (!get_mtime(locale_filename, &filedata->mtime))
+	*err_msg = get_mtime_and_size(locale_filename, &filedata->mtime, NULL);
+	if (*err_msg != NULL)
+	{
+		*open_error = TRUE;
 		return FALSE;
+	}
 
 	if (USE_GIO_FILE_OPERATIONS)
 	{
@@ -1077,22 +1132,23 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 
 	if (err)
 	{
-		ui_set_statusbar(TRUE, "%s", err->message);
+		*err_msg = g_strdup(err->message);
 		g_error_free(err);
 		return FALSE;
 	}
+	filedata->size = filedata->len;
 
 	if (! encodings_convert_to_utf8_auto(&filedata->data, &filedata->len, forced_enc,
 				&filedata->enc, &filedata->bom, &filedata->readonly))
 	{
 		if (forced_enc)
 		{
-			ui_set_statusbar(TRUE, _("The file \"%s\" is not valid %s."),
+			*err_msg = g_strdup_printf(_("The file \"%s\" is not valid %s."),
 				display_filename, forced_enc);
 		}
 		else
 		{
-			ui_set_statusbar(TRUE,
+			*err_msg = g_strdup_printf(
 	_("The file \"%s\" does not look like a text file or the file encoding is not supported."),
 			display_filename);
 		}
@@ -1100,7 +1156,20 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 		return FALSE;
 	}
 
-	if (filedata->readonly)
+	return TRUE;
+}
+
+static void show_read_text_file_result(const gchar *locale_filename,
+	const gchar *display_filename, FileData *filedata, const gchar *err_msg, gboolean open_error)
+{
+	if (err_msg != NULL)
+	{
+		if (open_error)
+			show_open_error(locale_filename, err_msg);
+		else
+			ui_set_statusbar(TRUE, "%s", err_msg);
+	}
+	else if (filedata->readonly)
 	{
 		const gchar *warn_msg = _(
 			"The file \"%s\" could not be opened properly and has been truncated. " \
@@ -1112,9 +1181,325 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 
 		ui_set_statusbar(TRUE, warn_msg, display_filename);
 	}
+}
 
-	return TRUE;
+/* loads textfile data, verifies and converts to forced_enc or UTF-8. Also handles BOM. */
+static gboolean load_text_file(const gchar *locale_filename, const gchar *display_filename,
+	FileData *filedata, const gchar *forced_enc)
+{
+	gchar *err_msg;
+	gboolean open_error;
+	gboolean ret;
+
+	ret = read_text_file(locale_filename, display_filename, filedata, forced_enc, &err_msg,
+			&open_error);
+	show_read_text_file_result(locale_filename, display_filename, filedata, err_msg, open_error);
+	g_free(err_msg);
+
+	return ret;
+}
+
+#define LARGE_FILE_CHUNK_SIZE (1024 * 1024)
+/* time spent appending text per idle callback, in microseconds */
+#define LARGE_FILE_SLICE_TIME 20000
+
+typedef struct
+{
+	GeanyDocument	*doc;
+	GInputStream	*stream;
+	gchar			*buffer;		/* LARGE_FILE_CHUNK_SIZE + 1 bytes */
+	gchar			 partial[4];	/* incomplete UTF-8 sequence at the end of the last chunk */
+	gsize			 partial_len;
+	goffset			 size;
+	goffset			 loaded;
+	gint			 percent;
+	gboolean		 readonly;		/* read-only state to restore when done */
+	guint			 source_id;
 }
+LargeFileLoader;
+
+static gboolean is_large_file_size(goffset size)
+{
+	return file_prefs.large_file_threshold > 0 &&
+		size >= (goffset) file_prefs.large_file_threshold * 1024 * 1024;
+}
+
+
+/* Whether the text has a line longer than file_prefs.large_file_line_length, like minified
+ * code, which makes line based features slow */
+static gboolean has_long_line(const gchar *data, gsize len)
+{
+	const gchar *end = data + len;
+	gsize max_len;
+
+	if (file_prefs.large_file_line_length <= 0)
+		return FALSE;
+
+	max_len = (gsize) file_prefs.large_file_line_length * 1024;
+	while ((gsize) (end - data) > max_len)
+	{
+		/* only look as far as the longest allowed line, for either line ending in one pass */
+		const gchar *limit = data + max_len + 1;
+		const gchar *p = data;
+
+		while (p < limit && *p != '\n' && *p != '\r')
+			p++;
+		if (p == limit)
+			return TRUE;
+		data = p + 1;
+	}
+	return FALSE;
+}
+
+
+static void large_file_loader_free(LargeFileLoader *loader)
+{
+	if (loader->source_id != 0)
+		g_source_remove(loader->source_id);
+	g_object_unref(loader->stream);
+	g_free(loader->buffer);
+	g_free(loader);
+}
+
+
+/* Returns how many bytes at the start of buf form complete UTF-8 sequences. */
+static gsize utf8_complete_length(const gchar *buf, gsize len)
+{
+	gsize i;
+
+	/* look back for the lead byte of the last sequence */
+	for (i = len; i > 0 && len - i < 4; i--)
+	{
+		guchar c = (guchar) buf[i - 1];
+
+		if ((c & 0xC0) != 0x80)
+		{
+			gsize seq_len = (c < 0x80) ? 1 : (c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : 2;
+
+			return (len - (i - 1) >= seq_len) ? len : i - 1;
+		}
+	}
+	return len;	/* invalid anyway, let validation fail */
+}
+
+
+/* Reads the next chunk into loader->buffer. Only complete and valid UTF-8 sequences are
+ * returned, an incomplete one at the end is kept for the next chunk.
+ * Returns the number of bytes, 0 at the end of the file or -1 on error. */
+static gssize large_file_read_chunk(LargeFileLoader *loader, gchar **err_msg)
+{
+	GError *error = NULL;
+	gsize len = loader->partial_len;
+	gsize bytes_read;
+	gsize complete;
+
+	memcpy(loader->buffer, loader->partial, len);
+	if (! g_input_stream_read_all(loader->stream, loader->buffer + len,
+			LARGE_FILE_CHUNK_SIZE - len, &bytes_read, NULL, &error))
+	{
+		*err_msg = g_strdup(error->message);
+		g_error_free(error);
+		return -1;
+	}
+	loader->loaded += bytes_read;
+	len += bytes_read;
+
+	/* at the end of the file an incomplete sequence is an error */
+	complete = (bytes_read > 0) ? utf8_complete_length(loader->buffer, len) : len;
+	if (! g_utf8_validate(loader->buffer, complete, NULL))
+	{
+		*err_msg = g_strdup(_("the file is not valid UTF-8"));
+		return -1;
+	}
+	loader->partial_len = len - complete;
+	memcpy(loader->partial, loader->buffer + complete, loader->partial_len);
+	loader->buffer[complete] = '\0';
+
+	return complete;
+}
+
+
+/* Opens a large file for streaming if it's UTF-8 and reads the first chunk into filedata.
+ * Returns NULL if the file should be loaded normally. */
+static LargeFileLoader *large_file_loader_new(const gchar *locale_filename,
+		const gchar *forced_enc, FileData *filedata)
+{
+	LargeFileLoader *loader;
+	GFileInputStream *stream;
+	GFile *file;
+	gchar *err_msg = NULL;
+	gssize len;
+	gsize text_len;
+	gchar *text;
+
+	filedata->enc = NULL;
+	filedata->bom = FALSE;
+	filedata->readonly = FALSE;
+
+	if (file_prefs.large_file_threshold <= 0)
+		return NULL;
+	if (forced_enc != NULL && ! utils_str_equal(forced_enc, "UTF-8"))
+		return NULL;
+
+	err_msg = get_mtime_and_size(locale_filename, &filedata->mtime, &filedata->size);
+	if (err_msg != NULL || ! is_large_file_size(filedata->size))
+	{
+		g_free(err_msg);
+		return NULL;
+	}
+
+	file = g_file_new_for_path(locale_filename);
+	stream = g_file_read(file, NULL, NULL);
+	g_object_unref(file);
+	if (stream == NULL)
+		return NULL;
+
+	loader = g_new0(LargeFileLoader, 1);
+	loader->stream = G_INPUT_STREAM(stream);
+	loader->buffer = g_malloc(LARGE_FILE_CHUNK_SIZE + 1);
+	loader->size = filedata->size;
+
+	len = large_file_read_chunk(loader, &err_msg);
+	g_free(err_msg);
+	if (len <= 0)
+	{
+		large_file_loader_free(loader);
+		return NULL;
+	}
+
+	/* let the usual detection handle BOMs and encoding cookies on the first chunk */
+	text = g_strndup(loader->buffer, len);
+	text_len = len;
+	if (! encodings_convert_to_utf8_auto(&text, &text_len, forced_enc, &filedata->enc,
+			&filedata->bom, &filedata->readonly) ||
+		! utils_str_equal(filedata->enc, "UTF-8") || filedata->readonly)
+	{
+		g_free(filedata->enc);
+		g_free(text);
+		large_file_loader_free(loader);
+		return NULL;
+	}
+	filedata->data = text;
+	filedata->len = text_len;
+
+	return loader;
+}
+
+
+static void large_file_load_finish(GeanyDocument *doc, LargeFileLoader *loader)
+{
+	ScintillaObject *sci = doc->editor->sci;
+
+	doc->readonly = loader->readonly;
+	sci_set_readonly(sci, doc->readonly);
+	/* loading the file can't be undone */
+	sci_set_undo_collection(sci, TRUE);
+	sci_empty_undo_buffer(sci);
+	document_undo_clear(doc);
+	doc->priv->line_count = sci_get_line_count(sci);
+	document_set_text_changed(doc, sci_is_modified(sci));	/* also updates tab state */
+	ui_document_show_hide(doc);
+
+	ui_set_statusbar(TRUE, _("File %s loaded in large file mode."), DOC_FILENAME(doc));
+}
+
+
+/* Loads the file the usual way if streaming failed, e.g. because it's not UTF-8 after all */
+static void large_file_load_fallback(GeanyDocument *doc, LargeFileLoader *loader,
+		const gchar *err_msg)
+{
+	doc->readonly = loader->readonly;
+	sci_set_undo_collection(doc->editor->sci, TRUE);
+	geany_debug("Could not stream %s (%s), loading it normally", DOC_FILENAME(doc), err_msg);
+
+	if (document_open_file_full(doc, NULL, 0, doc->readonly, doc->priv->favorite,
+			doc->file_type, NULL) != NULL)
+	{
+		/* don't keep the partially loaded text in the history */
+		document_undo_clear(doc);
+		sci_empty_undo_buffer(doc->editor->sci);
+	}
+}
+
+
+static gboolean large_file_load_idle(gpointer data)
+{
+	LargeFileLoader *loader = data;
+	GeanyDocument *doc = loader->doc;
+	ScintillaObject *sci = doc->editor->sci;
+	gint64 end_time = g_get_monotonic_time() + LARGE_FILE_SLICE_TIME;
+	gboolean modified = sci_is_modified(sci);
+	gchar *err_msg = NULL;
+	gssize len;
+	gint percent;
+
+	sci_set_readonly(sci, FALSE);
+	do
+	{
+		len = large_file_read_chunk(loader, &err_msg);
+		if (len > 0)
+			sci_append_text(sci, loader->buffer, len);
+	}
+	while (len > 0 && g_get_monotonic_time() < end_time);
+	sci_set_readonly(sci, doc->readonly);
+	/* appending isn't a user change, but don't hide one */
+	if (! modified)
+		sci_set_savepoint(sci);
+
+	if (len > 0)
+	{
+		percent = (gint) (loader->loaded * 100 / MAX(loader->size, 1));
+		if (percent != loader->percent)
+		{
+			loader->percent = percent;
+			ui_set_statusbar(FALSE, _("Loading %s (%d%%)..."), DOC_FILENAME(doc), percent);
+		}
+		return G_SOURCE_CONTINUE;
+	}
+
+	loader->source_id = 0;
+	doc->priv->large_file_loader = NULL;
+	if (len == 0)
+		large_file_load_finish(doc, loader);
+	else
+		large_file_load_fallback(doc, loader, err_msg);
+
+	g_free(err_msg);
+	large_file_loader_free(loader);
+	return G_SOURCE_REMOVE;
+}
+
+
+static void large_file_loader_start(GeanyDocument *doc, LargeFileLoader *loader)
+{
+	loader->doc = doc;
+	/* keep the document read-only until everything is loaded */
+	loader->readonly = doc->readonly;
+	doc->readonly = TRUE;
+	sci_set_readonly(doc->editor->sci, TRUE);
+	/* don't keep a copy of the appended chunks in the undo history */
+	sci_set_undo_collection(doc->editor->sci, FALSE);
+	sci_allocate(doc->editor->sci, loader->size + 1);
+
+	doc->priv->large_file_loader = loader;
+	loader->source_id = g_idle_add(large_file_load_idle, loader);
+	ui_document_show_hide(doc);
+}
+
+
+static void large_file_loader_cancel(GeanyDocument *doc)
+{
+	LargeFileLoader *loader = doc->priv->large_file_loader;
+
+	if (loader != NULL)
+	{
+		doc->readonly = loader->readonly;
+		sci_set_undo_collection(doc->editor->sci, TRUE);
+		doc->priv->large_file_loader = NULL;
+		large_file_loader_free(loader);
+	}
+}
+
 
 /* Sets the cursor position on opening a file. First it sets the line when cl_options.goto_line
  * is set, otherwise it sets the line when pos is greater than zero and finally it sets the column
@@ -1147,76 +1532,187 @@ static gint set_cursor_position(GeanyEditor *editor, gint pos)
 	return sci_get_current_position(editor->sci);
 }
 
-/* Count lines that start with some hard tabs then a soft tab. */
-static gboolean detect_tabs_and_spaces(GeanyEditor *editor)
+/* texts smaller than this are always scanned completely for the indentation */
+#define INDENT_SAMPLE_MIN_SIZE (256 * 1024)
+/* the text is sampled in this many evenly spread ranges of lines */
+#define INDENT_SAMPLE_STRATA 32
+/* lines per range of the first sample, larger samples take 8 times as many */
+#define INDENT_SAMPLE_LINES 64
+#define INDENT_SAMPLE_MAX_LINES 4096
+/* indented lines a sample needs for a confident result */
+#define INDENT_SAMPLE_MIN_INDENTED 32
+
+/* Indentation statistics of the lines of a text */
+typedef struct IndentStats
 {
-	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(editor);
-	ScintillaObject *sci = editor->sci;
-	gsize count = 0;
-	struct Sci_TextToFind ttf;
-	gchar *soft_tab = g_strnfill((gsize)iprefs->width, ' ');
-	gchar *regex = g_strconcat("^\t+", soft_tab, "[^ ]", NULL);
+	gsize		lines;
+	gsize		tabs;		/* lines indented with a tab */
+	gsize		spaces;		/* lines indented with at least 2 spaces */
+	gsize		mixed;		/* lines indented with tabs followed by a soft tab */
+	gsize		widths[7];	/* lines with an indent width dividable by 2 to 8 */
+	gboolean	sampled;
+}
+IndentStats;
 
-	g_free(soft_tab);
+/* Adds the line starting at p to stats, and returns the start of the next line.
+ * soft_width is the width of a soft tab and the tab width for the type detection, the width
+ * detection forces a tab width of 8. */
+static const gchar *add_line_indent_stats(IndentStats *stats, const gchar *p, const gchar *end,
+		gint soft_width)
+{
+	const gchar *start = p;
+	const gchar *q;
+	gint indent = 0, indent8 = 0;
 
-	ttf.chrg.cpMin = 0;
-	ttf.chrg.cpMax = sci_get_length(sci);
-	ttf.lpstrText = regex;
-	while (1)
+	for (; p < end && (*p == ' ' || *p == '\t'); p++)
+	{
+		if (*p == '\t')
+		{
+			indent = (indent / soft_width + 1) * soft_width;
+			indent8 = (indent8 / 8 + 1) * 8;
+		}
+		else
+		{
+			indent++;
+			indent8++;
+		}
+	}
+	stats->lines++;
+
+	/* most code will have indent total <= 24, otherwise it's more likely to be
+	 * alignment than indentation */
+	if (indent <= 24 && p > start)
+	{
+		if (*start == '\t')
+			stats->tabs++;
+		/* check for at least 2 spaces */
+		else if (p - start >= 2 && start[1] == ' ')
+			stats->spaces++;
+	}
+
+	/* hard tabs followed by exactly a soft tab and some text */
+	for (q = start; q < p && *q == '\t'; q++);
+	if (q > start && p - q == soft_width && p < end && *p != '\n' && *p != '\r')
+		stats->mixed++;
+
+	/* We don't have style info, so we can't use highlighting_is_code_style().
+	 * The assumption that concerning lines start with an asterisk (common continuation
+	 * character for C/C++/Java/...) should do the trick without removing too much
+	 * legitimate lines. */
+	if (indent8 >= 2 && indent8 <= 24 && (p >= end || *p != '*'))
 	{
-		gint pos;
+		gint i;
 
-		pos = sci_find_text(sci, SCFIND_REGEXP, &ttf);
-		if (pos == -1)
-			break;	/* no more matches */
-		count++;
-		ttf.chrg.cpMin = ttf.chrgText.cpMax + 1;	/* search after this match */
+		for (i = G_N_ELEMENTS(stats->widths) - 1; i >= 0; i--)
+		{
+			if ((indent8 % (i + 2)) == 0)
+				stats->widths[i]++;
+		}
 	}
-	g_free(regex);
-	/* The 0.02 is a low weighting to ignore a few possibly accidental occurrences */
-	return count > sci_get_line_count(sci) * 0.02;
+
+	while (p < end && *p != '\n' && *p != '\r')
+		p++;
+	if (p + 1 < end && p[0] == '\r' && p[1] == '\n')
+		p++;
+	return p < end ? p + 1 : end;
 }
 
-/* Detect the indent type based on counting the leading indent characters for each line.
- * Returns whether detection succeeded, and the detected type in *type_ upon success */
-gboolean document_detect_indent_type(GeanyDocument *doc, GeanyIndentType *type_)
+/* Collects the statistics of up to lines_per_range lines at the start of each of
+ * INDENT_SAMPLE_STRATA ranges of the text, or of all lines if lines_per_range is 0 */
+static void collect_indent_stats(IndentStats *stats, const gchar *text, gsize len,
+		gsize lines_per_range, gint soft_width)
 {
-	GeanyEditor *editor = doc->editor;
-	ScintillaObject *sci = editor->sci;
-	gint line, line_count;
-	gsize tabs = 0, spaces = 0;
+	const gchar *end = text + len;
+	guint i;
 
-	if (detect_tabs_and_spaces(editor))
+	memset(stats, 0, sizeof(*stats));
+	if (lines_per_range == 0)
 	{
-		*type_ = GEANY_INDENT_TYPE_BOTH;
-		return TRUE;
+		const gchar *p = text;
+
+		while (p < end)
+			p = add_line_indent_stats(stats, p, end, soft_width);
+		return;
 	}
 
-	line_count = sci_get_line_count(sci);
-	for (line = 0; line < line_count; line++)
+	stats->sampled = TRUE;
+	for (i = 0; i < INDENT_SAMPLE_STRATA; i++)
 	{
-		gint pos = sci_get_position_from_line(sci, line);
-		gchar c;
+		const gchar *p = text + len / INDENT_SAMPLE_STRATA * i;
+		const gchar *range_end = (i + 1 < INDENT_SAMPLE_STRATA) ?
+			text + len / INDENT_SAMPLE_STRATA * (i + 1) : end;
+		gsize n;
 
-		/* most code will have indent total <= 24, otherwise it's more likely to be
-		 * alignment than indentation */
-		if (sci_get_line_indentation(sci, line) > 24)
-			continue;
+		/* start at the next full line */
+		if (i > 0)
+		{
+			while (p < range_end && p[-1] != '\n' && p[-1] != '\r')
+				p++;
+		}
+		for (n = 0; n < lines_per_range && p < range_end; n++)
+			p = add_line_indent_stats(stats, p, end, soft_width);
+	}
+}
 
-		c = sci_get_char_at(sci, pos);
-		if (c == '\t')
-			tabs++;
-		/* check for at least 2 spaces */
-		else if (c == ' ' && sci_get_char_at(sci, pos + 1) == ' ')
-			spaces++;
+/* Whether a sample clearly decides the indentation type, rather than being close to the
+ * thresholds of indent_stats_get_type() */
+static gboolean indent_stats_are_confident(const IndentStats *stats)
+{
+	gsize most = MAX(stats->tabs, stats->spaces);
+	gsize least = MIN(stats->tabs, stats->spaces);
+
+	if (stats->tabs + stats->spaces < INDENT_SAMPLE_MIN_INDENTED)
+		return FALSE;
+	/* between 1% and 4% of mixed lines */
+	if (stats->mixed * 100 > stats->lines && stats->mixed * 25 < stats->lines)
+		return FALSE;
+	/* between 2 and 8 times as many lines of one type */
+	return least == 0 || most > least * 8 || most < least * 2;
+}
+
+/* Collects the indentation statistics of text from a sample of its lines, and from more
+ * lines while the sample is ambiguous */
+static void detect_indent_stats(IndentStats *stats, const gchar *text, gsize len,
+		gint soft_width)
+{
+	gsize lines_per_range;
+
+	if (len > INDENT_SAMPLE_MIN_SIZE)
+	{
+		for (lines_per_range = INDENT_SAMPLE_LINES; lines_per_range <= INDENT_SAMPLE_MAX_LINES;
+			lines_per_range *= 8)
+		{
+			collect_indent_stats(stats, text, len, lines_per_range, soft_width);
+			if (indent_stats_are_confident(stats))
+				return;
+		}
+	}
+	collect_indent_stats(stats, text, len, 0, soft_width);
+}
+
+static void get_document_indent_stats(GeanyDocument *doc, IndentStats *stats)
+{
+	ScintillaObject *sci = doc->editor->sci;
+
+	detect_indent_stats(stats, sci_get_character_pointer(sci), sci_get_length(sci),
+		editor_get_indent_prefs(doc->editor)->width);
+}
+
+static gboolean indent_stats_get_type(const IndentStats *stats, GeanyIndentType *type_)
+{
+	/* The 0.02 is a low weighting to ignore a few possibly accidental occurrences */
+	if (stats->mixed > stats->lines * 0.02)
+	{
+		*type_ = GEANY_INDENT_TYPE_BOTH;
+		return TRUE;
 	}
-	if (spaces == 0 && tabs == 0)
+	if (stats->spaces == 0 && stats->tabs == 0)
 		return FALSE;
 
 	/* the factors may need to be tweaked */
-	if (spaces > tabs * 4)
+	if (stats->spaces > stats->tabs * 4)
 		*type_ = GEANY_INDENT_TYPE_SPACES;
-	else if (tabs > spaces * 4)
+	else if (stats->tabs > stats->spaces * 4)
 		*type_ = GEANY_INDENT_TYPE_TABS;
 	else
 		*type_ = GEANY_INDENT_TYPE_BOTH;
@@ -1224,60 +1720,24 @@ gboolean document_detect_indent_type(GeanyDocument *doc, GeanyIndentType *type_)
 	return TRUE;
 }
 
-/* Detect the indent width based on counting the leading indent characters for each line.
- * Returns whether detection succeeded, and the detected width in *width_ upon success */
-static gboolean detect_indent_width(GeanyEditor *editor, GeanyIndentType type, gint *width_)
+static gboolean indent_stats_get_width(const IndentStats *stats, GeanyIndentType type,
+		gint default_width, gint *width_)
 {
-	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(editor);
-	ScintillaObject *sci = editor->sci;
-	gint line, line_count;
-	gint widths[7] = { 0 }; /* width can be from 2 to 8 */
-	gint count, width, i;
+	gsize count = 0;
+	gint width = default_width;
+	gint i;
 
 	/* can't easily detect the supposed width of a tab, guess the default is OK */
 	if (type == GEANY_INDENT_TYPE_TABS)
 		return FALSE;
 
-	/* force 8 at detection time for tab & spaces -- anyway we don't use tabs at this point */
-	sci_set_tab_width(sci, 8);
-
-	line_count = sci_get_line_count(sci);
-	for (line = 0; line < line_count; line++)
-	{
-		gint pos = sci_get_line_indent_position(sci, line);
-
-		/* We probably don't have style info yet, because we're generally called just after
-		 * the document got created, so we can't use highlighting_is_code_style().
-		 * That's not good, but the assumption below that concerning lines start with an
-		 * asterisk (common continuation character for C/C++/Java/...) should do the trick
-		 * without removing too much legitimate lines. */
-		if (sci_get_char_at(sci, pos) == '*')
-			continue;
-
-		width = sci_get_line_indentation(sci, line);
-		/* most code will have indent total <= 24, otherwise it's more likely to be
-		 * alignment than indentation */
-		if (width > 24)
-			continue;
-		/* < 2 is no indentation */
-		if (width < 2)
-			continue;
-
-		for (i = G_N_ELEMENTS(widths) - 1; i >= 0; i--)
-		{
-			if ((width % (i + 2)) == 0)
-				widths[i]++;
-		}
-	}
-	count = 0;
-	width = iprefs->width;
-	for (i = G_N_ELEMENTS(widths) - 1; i >= 0; i--)
+	for (i = G_N_ELEMENTS(stats->widths) - 1; i >= 0; i--)
 	{
 		/* give large indents higher weight not to be fooled by spurious indents */
-		if (widths[i] >= count * 1.5)
+		if (stats->widths[i] >= count * 1.5)
 		{
 			width = i + 2;
-			count = widths[i];
+			count = stats->widths[i];
 		}
 	}
 
@@ -1288,10 +1748,27 @@ static gboolean detect_indent_width(GeanyEditor *editor, GeanyIndentType type, g
 	return TRUE;
 }
 
-/* same as detect_indent_width() but uses editor's indent type */
+/* Detect the indent type based on counting the leading indent characters for each line,
+ * or a sample of the lines of large documents.
+ * Returns whether detection succeeded, and the detected type in *type_ upon success */
+gboolean document_detect_indent_type(GeanyDocument *doc, GeanyIndentType *type_)
+{
+	IndentStats stats;
+
+	get_document_indent_stats(doc, &stats);
+	return indent_stats_get_type(&stats, type_);
+}
+
+/* Detect the indent width based on counting the leading indent characters for each line,
+ * using the editor's indent type.
+ * Returns whether detection succeeded, and the detected width in *width_ upon success */
 gboolean document_detect_indent_width(GeanyDocument *doc, gint *width_)
 {
-	return detect_indent_width(doc->editor, doc->editor->indent_type, width_);
+	IndentStats stats;
+
+	get_document_indent_stats(doc, &stats);
+	return indent_stats_get_width(&stats, doc->editor->indent_type,
+		editor_get_indent_prefs(doc->editor)->width, width_);
 }
 
 void document_apply_indent_settings(GeanyDocument *doc)
@@ -1299,8 +1776,23 @@ void document_apply_indent_settings(GeanyDocument *doc)
 	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(NULL);
 	GeanyIndentType type = iprefs->type;
 	gint width = iprefs->width;
+	IndentStats stats;
+	const IndentStats *detected = doc->priv->indent_stats;
 
-	if (iprefs->detect_type && document_detect_indent_type(doc, &type))
+	/* use the statistics of the loaded text when opening the file */
+	if (detected == NULL && (iprefs->detect_type || iprefs->detect_width))
+	{
+		get_document_indent_stats(doc, &stats);
+		detected = &stats;
+	}
+	if (detected != NULL && detected->sampled)
+	{
+		geany_debug("Detecting the indentation of %s from %" G_GSIZE_FORMAT " sampled lines, "
+			"%" G_GSIZE_FORMAT " tab and %" G_GSIZE_FORMAT " space indented",
+			DOC_FILENAME(doc), detected->lines, detected->tabs, detected->spaces);
+	}
+
+	if (iprefs->detect_type && indent_stats_get_type(detected, &type))
 	{
 		if (type != iprefs->type)
 		{
@@ -1327,7 +1819,7 @@ void document_apply_indent_settings(GeanyDocument *doc)
 	else if (doc->file_type->indent_type > -1)
 		type = doc->file_type->indent_type;
 
-	if (iprefs->detect_width && detect_indent_width(doc->editor, type, &width))
+	if (iprefs->detect_width && indent_stats_get_width(detected, type, iprefs->width, &width))
 	{
 		if (width != iprefs->width)
 		{
@@ -1360,13 +1852,11 @@ void document_show_tab_real(GeanyDocument *doc)
 		document_try_focus(doc, NULL);
 }
 
-/* To open a new file, set doc to NULL; filename should be locale encoded.
- * To reload a file, set the doc for the document to be reloaded; filename should be NULL.
- * pos is the cursor position, which can be overridden by --line and --column.
- * forced_enc can be NULL to detect the file encoding.
- * Returns: doc of the opened file or NULL if an error occurred. */
-GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
-		gboolean readonly, gboolean favorite, GeanyFiletype *ft, const gchar *forced_enc)
+/* preloaded is the already read file data when reloading several documents in a batch, see
+ * document_reload_all(). The tags of such documents aren't updated here. */
+static GeanyDocument *open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
+		gboolean readonly, gboolean favorite, GeanyFiletype *ft, const gchar *forced_enc,
+		FileData *preloaded)
 {
 	gint editor_mode;
 	gboolean reload = (doc == NULL) ? FALSE : TRUE;
@@ -1377,11 +1867,14 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 	FileData filedata;
 	UndoReloadData *undo_reload_data;
 	gboolean add_undo_reload_action;
+	gboolean large_file;
+	LargeFileLoader *loader = NULL;
 
 	g_return_val_if_fail(doc == NULL || doc->is_valid, NULL);
 
 	if (reload)
 	{
+		large_file_loader_cancel(doc);
 		utf8_filename = g_strdup(doc->file_name);
 		locale_filename = utils_get_locale_from_utf8(utf8_filename);
 	}
@@ -1416,7 +1909,13 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 	{	/* doc possibly changed */
 		display_filename = utils_str_middle_truncate(utf8_filename, 100);
 
-		if (! load_text_file(locale_filename, display_filename, &filedata, forced_enc))
+		if (preloaded != NULL)
+			filedata = *preloaded;
+		else if (! reload)
+			loader = large_file_loader_new(locale_filename, forced_enc, &filedata);
+
+		if (preloaded == NULL && loader == NULL &&
+			! load_text_file(locale_filename, display_filename, &filedata, forced_enc))
 		{
 			g_free(display_filename);
 			g_free(utf8_filename);
@@ -1462,6 +1961,19 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 			add_undo_reload_action = FALSE;
 		}
 
+		/* detect the indentation on the loaded text, it's applied once the filetype is set */
+		if (! reload)
+		{
+			const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(NULL);
+
+			if (iprefs->detect_type || iprefs->detect_width)
+			{
+				doc->priv->indent_stats = g_new(IndentStats, 1);
+				detect_indent_stats(doc->priv->indent_stats, filedata.data, filedata.len,
+					iprefs->width);
+			}
+		}
+
 		/* add the text to the ScintillaObject */
 		sci_set_readonly(doc->editor->sci, FALSE);	/* to allow replacing text */
 		sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
@@ -1477,6 +1989,7 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 				add_undo_reload_action = TRUE;
 		}
 		sci_set_eol_mode(doc->editor->sci, editor_mode);
+		large_file = is_large_file_size(filedata.size) || has_long_line(filedata.data, filedata.len);
 		g_free(filedata.data);
 
 		sci_set_undo_collection(doc->editor->sci, TRUE);
@@ -1492,6 +2005,10 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		}
 
 		doc->priv->mtime = filedata.mtime; /* get the modification time from file and keep it */
+		doc->priv->disk_size = filedata.size;
+		doc->priv->large_file = large_file;
+		sci_set_folding_margin_visible(doc->editor->sci,
+			editor_prefs.folding && ! doc->priv->large_file);
 		g_free(doc->encoding);	/* if reloading, free old encoding */
 		doc->encoding = filedata.enc;
 		doc->has_bom = filedata.bom;
@@ -1535,7 +2052,11 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 				 * been "invisible" changes to the document, such as changes in encoding and
 				 * EOL mode, but for the time being that's how we roll. */
 				if (undo_reload_data->actions_count > 0 || add_undo_reload_action)
+				{
 					document_undo_add(doc, UNDO_RELOAD, undo_reload_data);
+					/* the previous text is kept in the history, keep that within budget */
+					queue_undo_memory_check();
+				}
 				else
 					g_free(undo_reload_data);
 
@@ -1551,13 +2072,16 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 			use_ft = ft;
 		}
 		/* update taglist, typedef keywords and build menu if necessary */
-		document_set_filetype(doc, use_ft);
+		if (preloaded == NULL)
+			document_set_filetype(doc, use_ft);
 
 		/* set indentation settings after setting the filetype */
 		if (reload)
 			editor_set_indent(doc->editor, doc->editor->indent_type, doc->editor->indent_width); /* resetup sci */
 		else
 			document_apply_indent_settings(doc);
+		g_free(doc->priv->indent_stats);
+		doc->priv->indent_stats = NULL;
 
 		document_set_text_changed(doc, FALSE);	/* also updates tab state */
 		ui_document_show_hide(doc);	/* update the document menu */
@@ -1569,7 +2093,8 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		if (reload)
 		{
 			g_signal_emit_by_name(geany_object, "document-reload", doc);
-			ui_set_statusbar(TRUE, _("File %s reloaded."), display_filename);
+			if (preloaded == NULL)
+				ui_set_statusbar(TRUE, _("File %s reloaded."), display_filename);
 		}
 		else
 		{
@@ -1582,6 +2107,10 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 				(readonly) ? _(", read-only") : "");
 		}
 
+		/* the first chunk of a large file is shown now, the rest is appended in the background */
+		if (loader != NULL)
+			large_file_loader_start(doc, loader);
+
 		/* now the document is fully ready, display it (see notebook_new_tab()) */
 		gtk_widget_show(document_get_notebook_child(doc));
 
@@ -1604,6 +2133,17 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 	return doc;
 }
 
+/* To open a new file, set doc to NULL; filename should be locale encoded.
+ * To reload a file, set the doc for the document to be reloaded; filename should be NULL.
+ * pos is the cursor position, which can be overridden by --line and --column.
+ * forced_enc can be NULL to detect the file encoding.
+ * Returns: doc of the opened file or NULL if an error occurred. */
+GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
+		gboolean readonly, gboolean favorite, GeanyFiletype *ft, const gchar *forced_enc)
+{
+	return open_file_full(doc, filename, pos, readonly, favorite, ft, forced_enc, NULL);
+}
+
 /* Takes a new line separated list of filename URIs and opens each file.
  * length is the length of the string */
 void document_open_file_list(const gchar *data, gsize length)
@@ -1860,6 +2400,8 @@ gboolean document_reload_force(GeanyDocument *doc, const gchar *forced_enc)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	document_finish_async_save(doc);
+
 	/* Use cancel because the response handler would call this recursively */
 	if (doc->priv->info_bars[MSG_TYPE_RELOAD] != NULL)
 		gtk_info_bar_response(GTK_INFO_BAR(doc->priv->info_bars[MSG_TYPE_RELOAD]), GTK_RESPONSE_CANCEL);
@@ -1920,6 +2462,152 @@ gboolean document_reload_prompt(GeanyDocument *doc, const gchar *forced_enc)
 	return result;
 }
 
+typedef struct ReloadAllItem
+{
+	GeanyDocument	*doc;
+	guint			 doc_id;
+	guint			 text_changes;	/* doc->priv->text_changes when the reading started */
+	gchar			*locale_filename;
+	gchar			*display_filename;
+	FileData		 filedata;
+	gboolean		 loaded;
+	gchar			*err_msg;
+	gboolean		 open_error;
+}
+ReloadAllItem;
+
+typedef struct ReloadAllData
+{
+	GAsyncQueue		*done_queue;
+	gint			 cancelled;
+}
+ReloadAllData;
+
+static void reload_all_item_free(ReloadAllItem *item)
+{
+	if (item->loaded)
+	{
+		g_free(item->filedata.data);
+		g_free(item->filedata.enc);
+	}
+	g_free(item->locale_filename);
+	g_free(item->display_filename);
+	g_free(item->err_msg);
+	g_free(item);
+}
+
+/* Worker thread function, reads and converts the file of one document */
+static void reload_all_read_file(gpointer item_data, gpointer user_data)
+{
+	ReloadAllItem *item = item_data;
+	ReloadAllData *data = user_data;
+
+	if (! g_atomic_int_get(&data->cancelled))
+	{
+		item->loaded = read_text_file(item->locale_filename, item->display_filename,
+				&item->filedata, NULL, &item->err_msg, &item->open_error);
+	}
+	g_async_queue_push(data->done_queue, item);
+}
+
+/* Returns whether the document needs to be reloaded, i.e. whether it has been edited or its
+ * file on disk doesn't match the last loaded or saved state anymore */
+static gboolean reload_all_needs_reload(GeanyDocument *doc, const gchar *locale_filename)
+{
+	time_t mtime;
+	goffset size;
+	gchar *err_msg;
+
+	document_finish_async_save(doc);
+
+	/* the disk check updates the mtime when it asks to reload, so a pending request counts */
+	if (doc->changed || doc->priv->info_bars[MSG_TYPE_RELOAD] != NULL)
+		return TRUE;
+
+	err_msg = get_mtime_and_size(locale_filename, &mtime, &size);
+	if (err_msg != NULL)
+	{
+		/* let the reading report the error */
+		g_free(err_msg);
+		return TRUE;
+	}
+	return mtime != doc->priv->mtime || size != doc->priv->disk_size;
+}
+
+/* Replaces the text of each document and updates the tags of all of them at once */
+static void reload_all_apply(GPtrArray *items)
+{
+	GPtrArray *reloaded = g_ptr_array_new();
+	guint i;
+
+	for (i = 0; i < items->len; i++)
+	{
+		ReloadAllItem *item = items->pdata[i];
+		GeanyDocument *doc = item->doc;
+
+		show_read_text_file_result(item->locale_filename, item->display_filename,
+				&item->filedata, item->err_msg, item->open_error);
+
+		if (! item->loaded || ! DOC_VALID(doc) || doc->id != item->doc_id)
+			continue;
+
+		/* the UI stays responsive while reading, so the text may have been edited since the
+		 * user confirmed reloading */
+		if (doc->priv->text_changes != item->text_changes &&
+			! dialogs_show_question_full(NULL, _("_Reload"), _("_Skip"),
+				_("The changes made while reloading will be lost."),
+				_("'%s' was edited while reloading. Reload it anyway?"), item->display_filename))
+		{
+			continue;
+		}
+
+		if (doc->priv->info_bars[MSG_TYPE_RELOAD] != NULL)
+			gtk_info_bar_response(GTK_INFO_BAR(doc->priv->info_bars[MSG_TYPE_RELOAD]),
+					GTK_RESPONSE_CANCEL);
+
+		/* open_file_full() takes over the data */
+		item->loaded = FALSE;
+		if (open_file_full(doc, NULL, sci_get_current_position(doc->editor->sci),
+				doc->readonly, doc->priv->favorite, doc->file_type, NULL, &item->filedata))
+			g_ptr_array_add(reloaded, doc);
+	}
+
+	/* parse all documents first and merge their tags into the workspace once */
+	for (i = 0; i < reloaded->len; i++)
+	{
+		GeanyDocument *doc = reloaded->pdata[i];
+
+		if (doc->tm_file != NULL && filetype_has_tags(doc->file_type))
+		{
+			tm_workspace_update_source_file_buffer_noupdate(doc->tm_file,
+				(guchar *) sci_get_character_pointer(doc->editor->sci),
+				sci_get_length(doc->editor->sci));
+		}
+	}
+	if (reloaded->len > 0)
+		tm_workspace_update();
+
+	for (i = 0; i < reloaded->len; i++)
+	{
+		GeanyDocument *doc = reloaded->pdata[i];
+
+		if (doc->tm_file == NULL)
+			document_update_tags(doc); /* creates the TM source file if needed */
+		else
+		{
+			sidebar_update_tag_list(doc, TRUE);
+			document_highlight_tags(doc);
+		}
+	}
+
+	if (reloaded->len > 0)
+	{
+		ui_set_statusbar(TRUE, ngettext("%u file reloaded.", "%u files reloaded.",
+				reloaded->len), reloaded->len);
+	}
+	g_ptr_array_free(reloaded, TRUE);
+}
+
 void document_reload_all()
 {
 	main_status.reloading_all_files = TRUE;
@@ -1929,47 +2617,82 @@ void document_reload_all()
 			_("Reload all opened documents?")))
 	{
 		GtkWidget *status_window, *label;
-		gint i;
+		GPtrArray *items = g_ptr_array_new();
+		ReloadAllData data = { NULL, 0 };
+		GThreadPool *pool;
+		GeanyDocument *doc;
+		guint i, pending;
 
 		dialogs_create_cancellable_status_window(&status_window, &label, "Reloading Files",
-				"Reloading files...", TRUE);
+				"Checking files...", TRUE);
 
-		for (int i = 0; i < 4 && gtk_events_pending(); ++i)
+		for (int j = 0; j < 4 && gtk_events_pending(); ++j)
 			gtk_main_iteration();
 
-		foreach_document(i)
+		/* only reload what has changed in the editor or on disk, in tab order */
+		foreach_ordered_document(doc)
 		{
-			GeanyDocument *doc = documents[i];
-
 			if (doc->real_path)
 			{
-				for (int i = 0; i < 4 && gtk_events_pending(); ++i)
-					gtk_main_iteration();
+				gchar *locale_filename = utils_get_locale_from_utf8(doc->file_name);
 
-				if (status_window == NULL)
+				if (reload_all_needs_reload(doc, locale_filename))
 				{
-					dialogs_show_msgbox(GTK_MESSAGE_WARNING, "Cancelled.");
-					break;
+					ReloadAllItem *item = g_new0(ReloadAllItem, 1);
+
+					item->doc = doc;
+					item->doc_id = doc->id;
+					item->text_changes = doc->priv->text_changes;
+					item->locale_filename = locale_filename;
+					item->display_filename = utils_str_middle_truncate(doc->file_name, 100);
+					g_ptr_array_add(items, item);
 				}
+				else
+					g_free(locale_filename);
+			}
+		}
 
-				gchar *real_path_utf8 = utils_get_utf8_from_locale(doc->real_path);
-				ui_label_set_text(GTK_LABEL(label), "Reloading '%s'...", real_path_utf8);
-				g_free(real_path_utf8);
-
-				for (int i = 0; i < 4 && gtk_events_pending(); ++i)
-					gtk_main_iteration();
+		/* read and convert the files in parallel while keeping the UI responsive */
+		data.done_queue = g_async_queue_new();
+		pool = g_thread_pool_new(reload_all_read_file, &data, utils_get_num_processors(), FALSE, NULL);
+		for (i = 0; i < items->len; i++)
+			g_thread_pool_push(pool, items->pdata[i], NULL);
 
-				if (document_reload_force(doc, NULL) == FALSE)
+		for (pending = items->len; pending > 0; )
+		{
+			if (g_async_queue_timeout_pop(data.done_queue, 20000) != NULL)
+			{
+				pending--;
+				if (status_window != NULL)
 				{
-					dialogs_show_msgbox(GTK_MESSAGE_ERROR, "Failed to reload '%s'.",
-							doc->file_name);
-					break;
+					ui_label_set_text(GTK_LABEL(label), "Reading files... (%u/%u)",
+							items->len - pending, items->len);
 				}
 			}
+
+			while (gtk_events_pending())
+				gtk_main_iteration();
+
+			if (status_window == NULL)
+				g_atomic_int_set(&data.cancelled, TRUE);
 		}
+		g_thread_pool_free(pool, FALSE, TRUE);
+		g_async_queue_unref(data.done_queue);
+
+		if (status_window == NULL)
+			dialogs_show_msgbox(GTK_MESSAGE_WARNING, "Cancelled.");
+		else
+		{
+			ui_label_set_text(GTK_LABEL(label), "Reloading files...");
+			for (int j = 0; j < 4 && gtk_events_pending(); ++j)
+				gtk_main_iteration();
 
-		if (status_window)
+			reload_all_apply(items);
 			gtk_widget_destroy(status_window);
+		}
+
+		g_ptr_array_foreach(items, (GFunc) reload_all_item_free, NULL);
+		g_ptr_array_free(items, TRUE);
 	}
 
 	main_status.reloading_all_files = FALSE;
@@ -2342,6 +3065,46 @@ gboolean document_save_file_as(GeanyDocument *doc, const gchar *utf8_fname)
 	return ret;
 }
 
+/* data is the UTF-8 text which failed to convert, it's used to show the context of the error */
+static void show_convert_to_encoding_error(GeanyDocument *doc, const gchar *encoding,
+		GError *conv_error, const gchar *data, gsize len, gsize bytes_read)
+{
+	gchar *text = g_strdup_printf(
+_("An error occurred while converting the file from UTF-8 in \"%s\". The file remains unsaved."),
+		encoding);
+	gchar *error_text;
+
+	if (conv_error->code == G_CONVERT_ERROR_ILLEGAL_SEQUENCE)
+	{
+		gint line, column;
+		gint context_len;
+		gunichar unic;
+		/* don't read over the doc length */
+		gsize max_len = MIN(bytes_read + 6, len - 1);
+		gchar context[7]; /* read 6 bytes + '\0' */
+
+		memcpy(context, data + bytes_read, max_len - bytes_read);
+		context[max_len - bytes_read] = '\0';
+
+		/* take only one valid Unicode character from the context and discard the leftover */
+		unic = g_utf8_get_char_validated(context, -1);
+		context_len = g_unichar_to_utf8(unic, context);
+		context[context_len] = '\0';
+		get_line_column_from_pos(doc, bytes_read, &line, &column);
+
+		error_text = g_strdup_printf(
+			_("Error message: %s\nThe error occurred at \"%s\" (line: %d, column: %d)."),
+			conv_error->message, context, line + 1, column);
+	}
+	else
+		error_text = g_strdup_printf(_("Error message: %s."), conv_error->message);
+
+	geany_debug("encoding error: %s", conv_error->message);
+	dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, text, error_text);
+	g_free(text);
+	g_free(error_text);
+}
+
 static gsize save_convert_to_encoding(GeanyDocument *doc, gchar **data, gsize *len)
 {
 	GError *conv_error = NULL;
@@ -2358,39 +3121,8 @@ static gsize save_convert_to_encoding(GeanyDocument *doc, gchar **data, gsize *l
 
 	if (conv_error != NULL)
 	{
-		gchar *text = g_strdup_printf(
-_("An error occurred while converting the file from UTF-8 in \"%s\". The file remains unsaved."),
-			doc->encoding);
-		gchar *error_text;
-
-		if (conv_error->code == G_CONVERT_ERROR_ILLEGAL_SEQUENCE)
-		{
-			gint line, column;
-			gint context_len;
-			gunichar unic;
-			/* don't read over the doc length */
-			gint max_len = MIN((gint)bytes_read + 6, (gint)*len - 1);
-			gchar context[7]; /* read 6 bytes from Sci + '\0' */
-			sci_get_text_range(doc->editor->sci, bytes_read, max_len, context);
-
-			/* take only one valid Unicode character from the context and discard the leftover */
-			unic = g_utf8_get_char_validated(context, -1);
-			context_len = g_unichar_to_utf8(unic, context);
-			context[context_len] = '\0';
-			get_line_column_from_pos(doc, bytes_read, &line, &column);
-
-			error_text = g_strdup_printf(
-				_("Error message: %s\nThe error occurred at \"%s\" (line: %d, column: %d)."),
-				conv_error->message, context, line + 1, column);
-		}
-		else
-			error_text = g_strdup_printf(_("Error message: %s."), conv_error->message);
-
-		geany_debug("encoding error: %s", conv_error->message);
-		dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, text, error_text);
+		show_convert_to_encoding_error(doc, doc->encoding, conv_error, *data, *len, bytes_read);
 		g_error_free(conv_error);
-		g_free(text);
-		g_free(error_text);
 		return FALSE;
 	}
 	else
@@ -2548,33 +3280,221 @@ static gboolean save_file_handle_infobars(GeanyDocument *doc, gboolean force)
 	return TRUE;
 }
 
-/**
- *  Saves the document.
- *  Also shows the Save As dialog if necessary.
- *  If the file is not modified, this function may do nothing unless @a force is set to @c TRUE.
- *
- *  Saving may include replacing tabs with spaces,
- *  stripping trailing spaces and adding a final new line at the end of the file, depending
- *  on user preferences. Then the @c "document-before-save" signal is emitted,
- *  allowing plugins to modify the document before it is saved, and data is
- *  actually written to disk.
- *
- *  On successful saving:
- *  - GeanyDocument::real_path is set.
- *  - The filetype is set again or auto-detected if it wasn't set yet.
- *  - The @c "document-save" signal is emitted for plugins.
- *
- *  @warning You should ensure @c doc->file_name has an absolute path unless you want the
- *  Save As dialog to be shown. A @c NULL value also shows the dialog. This behaviour was
- *  added in Geany 1.22.
- *
- *  @param doc The document to save.
- *  @param force Whether to save the file even if it is not modified.
- *
- *  @return @c TRUE if the file was saved or @c FALSE if the file could not or should not be saved.
- **/
-GEANY_API_SYMBOL
-gboolean document_save_file(GeanyDocument *doc, gboolean force)
+typedef struct AsyncSaveData
+{
+	guint		 doc_id;
+	gchar		*locale_filename;
+	gchar		*utf8_data;		/* snapshot of the buffer, kept for conversion error messages */
+	gchar		*data;			/* data to write, same as utf8_data unless converted */
+	gsize		 len;			/* length of data including the trailing NUL byte */
+	gchar		*encoding;		/* target encoding or NULL if no conversion is needed */
+	gint		 undo_action;	/* Scintilla undo action the snapshot corresponds to */
+	GError		*conv_error;
+	gsize		 bytes_read;
+	gchar		*errmsg;
+	gboolean	 maybe_truncated;	/* whether a failed write may have truncated the file */
+	GThread		*thread;
+	gboolean	 finished;
+}
+AsyncSaveData;
+
+static void async_save_data_free(AsyncSaveData *data)
+{
+	if (data->data != data->utf8_data)
+		g_free(data->data);
+	g_free(data->utf8_data);
+	g_free(data->locale_filename);
+	g_free(data->encoding);
+	if (data->conv_error)
+		g_error_free(data->conv_error);
+	g_free(data->errmsg);
+	g_free(data);
+}
+
+static void report_save_error(GeanyDocument *doc, gchar *errmsg, gboolean maybe_truncated)
+{
+	ui_set_statusbar(TRUE, _("Error saving file (%s)."), errmsg);
+
+	if (maybe_truncated)
+	{
+		SETPTR(errmsg,
+			g_strdup_printf(_("%s\n\nThe file on disk may now be truncated!"), errmsg));
+	}
+	dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, _("Error saving file."), errmsg);
+	doc->priv->file_disk_status = FILE_OK;
+	utils_beep();
+	g_free(errmsg);
+}
+
+/* Updates the document state after its data has been written to disk */
+static void save_file_finish(GeanyDocument *doc, const gchar *locale_filename)
+{
+	/* ignore the following things if we are quitting */
+	if (! main_status.quitting)
+	{
+		if (file_prefs.disk_check_timeout > 0)
+			document_update_timestamp(doc, locale_filename);
+
+		/* update filetype-related things */
+		document_set_filetype(doc, doc->file_type);
+
+		document_update_tab_label(doc);
+
+		msgwin_status_add(_("File %s saved."), doc->file_name);
+		ui_update_statusbar(doc, -1);
+#ifdef HAVE_VTE
+		vte_cwd_document(doc, VTE_SHOW_DIR_NOT_CHANGED);
+#endif
+	}
+
+	g_signal_emit_by_name(geany_object, "document-save", doc);
+}
+
+static void async_save_finish(GeanyDocument *doc, AsyncSaveData *data)
+{
+	ScintillaObject *sci = doc->editor->sci;
+
+	g_thread_join(data->thread);
+	data->thread = NULL;
+	data->finished = TRUE;
+	doc->priv->async_save = NULL;
+
+	if (data->conv_error != NULL)
+	{
+		show_convert_to_encoding_error(doc, data->encoding, data->conv_error,
+			data->utf8_data, data->len, data->bytes_read);
+		doc->priv->file_disk_status = FILE_OK;
+		return;
+	}
+	if (data->errmsg != NULL)
+	{
+		report_save_error(doc, data->errmsg, data->maybe_truncated);
+		data->errmsg = NULL;
+		return;
+	}
+
+	store_saved_encoding(doc);
+	doc->priv->disk_size = data->len - 1;
+
+	/* if the user kept editing while the file was written, only mark the snapshot state
+	 * as saved so undoing back to it still clears the modified flag */
+	if (sci_get_undo_current(sci) == data->undo_action)
+		sci_set_savepoint(sci);
+	else
+		sci_set_undo_save_point(sci, data->undo_action);
+
+	save_file_finish(doc, data->locale_filename);
+}
+
+static gboolean async_save_done_idle(gpointer user_data)
+{
+	AsyncSaveData *data = user_data;
+
+	if (! data->finished)
+	{
+		GeanyDocument *doc = document_find_by_id(data->doc_id);
+
+		if (doc != NULL && doc->priv->async_save == data)
+			async_save_finish(doc, data);
+		else
+		{
+			/* the document is gone, but the user still has to know the file wasn't saved */
+			g_thread_join(data->thread);
+			if (data->conv_error != NULL || data->errmsg != NULL)
+			{
+				gchar *display_name = utils_get_utf8_from_locale(data->locale_filename);
+				gchar *msg = g_strdup_printf("%s: %s", display_name,
+					data->conv_error != NULL ? data->conv_error->message : data->errmsg);
+
+				ui_set_statusbar(TRUE, _("Error saving file (%s)."), msg);
+				dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, _("Error saving file."), msg);
+				g_free(msg);
+				g_free(display_name);
+			}
+		}
+	}
+	async_save_data_free(data);
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer async_save_thread(gpointer user_data)
+{
+	AsyncSaveData *data = user_data;
+
+	if (data->encoding != NULL)
+	{
+		gsize conv_len;
+
+		data->data = g_convert(data->utf8_data, data->len - 1, data->encoding, "UTF-8",
+				&data->bytes_read, &conv_len, &data->conv_error);
+		if (data->data != NULL)
+			data->len = conv_len + 1;
+	}
+	if (data->conv_error == NULL)
+	{
+		data->errmsg = write_data_to_disk(data->locale_filename, data->data, data->len - 1);
+	}
+	g_idle_add(async_save_done_idle, data);
+	return NULL;
+}
+
+/* Waits for a pending background save of doc and applies its result */
+void document_finish_async_save(GeanyDocument *doc)
+{
+	g_return_if_fail(doc != NULL);
+
+	if (doc->priv->async_save != NULL)
+		async_save_finish(doc, doc->priv->async_save);
+}
+
+/* Snapshots the buffer and converts and writes it in a worker thread. The document stays
+ * editable meanwhile; the save point, mtime and disk status are updated on completion. */
+static gboolean save_file_async(GeanyDocument *doc)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	AsyncSaveData *data = g_new0(AsyncSaveData, 1);
+	gsize text_len = sci_get_length(sci);
+	gsize offset = 0;
+
+	/* close any coalescing undo action so later edits can't merge into the snapshot */
+	sci_start_undo_action(sci);
+	sci_end_undo_action(sci);
+
+	data->doc_id = doc->id;
+	data->undo_action = sci_get_undo_current(sci);
+	data->maybe_truncated = ! file_prefs.use_safe_file_saving;
+	data->locale_filename = utils_get_locale_from_utf8(doc->file_name);
+
+	if (doc->has_bom && encodings_is_unicode_charset(doc->encoding))
+	{	/* see document_save_file() */
+		data->utf8_data = g_malloc(text_len + 4);
+		memcpy(data->utf8_data, "\xef\xbb\xbf", 3);
+		offset = 3;
+	}
+	else
+		data->utf8_data = g_malloc(text_len + 1);
+
+	memcpy(data->utf8_data + offset, sci_get_character_pointer(sci), text_len);
+	data->utf8_data[offset + text_len] = '\0';
+	data->data = data->utf8_data;
+	data->len = offset + text_len + 1;
+
+	if (doc->encoding != NULL && ! utils_str_equal(doc->encoding, "UTF-8") &&
+		! utils_str_equal(doc->encoding, encodings[GEANY_ENCODING_NONE].charset))
+	{
+		data->encoding = g_strdup(doc->encoding);
+	}
+
+	/* ignore file changed notification when the file is written */
+	doc->priv->file_disk_status = FILE_IGNORE;
+	doc->priv->async_save = data;
+
+	ui_set_statusbar(FALSE, _("Saving file %s..."), doc->file_name);
+	data->thread = g_thread_new("geany-save", async_save_thread, data);
+	return TRUE;
+}
+
+static gboolean save_file(GeanyDocument *doc, gboolean force, gboolean allow_async)
 {
 	gchar *errmsg;
 	gchar *data;
@@ -2584,6 +3504,9 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	/* a previous background save has to complete first */
+	document_finish_async_save(doc);
+
 	if (document_need_save_as(doc))
 	{
 		/* ensure doc is the current tab before showing the dialog */
@@ -2593,6 +3516,12 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 
 	if (!force && !doc->changed)
 		return FALSE;
+	/* saving a half loaded file would truncate it */
+	if (doc->priv->large_file_loader != NULL)
+	{
+		ui_set_statusbar(TRUE, _("%s is still being loaded."), DOC_FILENAME(doc));
+		return FALSE;
+	}
 	if (doc->readonly)
 	{
 		document_try_focus(doc, NULL);
@@ -2622,6 +3551,14 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 	/* notify plugins which may wish to modify the document before it's saved */
 	g_signal_emit_by_name(geany_object, "document-before-save", doc);
 
+	/* only existing files are saved in the background, new files need their real path and
+	 * file monitoring set up before returning */
+	if (allow_async && file_prefs.use_async_file_saving && doc->real_path != NULL &&
+		! main_status.quitting)
+	{
+		return save_file_async(doc);
+	}
+
 	len = sci_get_length(doc->editor->sci) + 1;
 	if (doc->has_bom && encodings_is_unicode_charset(doc->encoding))
 	{	/* always write a UTF-8 BOM because in this moment the text itself is still in UTF-8
@@ -2666,48 +3603,177 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 
 	if (errmsg != NULL)
 	{
-		ui_set_statusbar(TRUE, _("Error saving file (%s)."), errmsg);
-
-		if (!file_prefs.use_safe_file_saving)
-		{
-			SETPTR(errmsg,
-				g_strdup_printf(_("%s\n\nThe file on disk may now be truncated!"), errmsg));
-		}
-		dialogs_show_msgbox_with_secondary(GTK_MESSAGE_ERROR, _("Error saving file."), errmsg);
-		doc->priv->file_disk_status = FILE_OK;
-		utils_beep();
+		report_save_error(doc, errmsg, !file_prefs.use_safe_file_saving);
 		g_free(locale_filename);
-		g_free(errmsg);
 		return FALSE;
 	}
 
 	/* store the opened encoding for undo/redo */
 	store_saved_encoding(doc);
+	doc->priv->disk_size = len;
 
-	/* ignore the following things if we are quitting */
 	if (! main_status.quitting)
-	{
 		sci_set_savepoint(doc->editor->sci);
 
-		if (file_prefs.disk_check_timeout > 0)
-			document_update_timestamp(doc, locale_filename);
+	save_file_finish(doc, locale_filename);
+	g_free(locale_filename);
 
-		/* update filetype-related things */
-		document_set_filetype(doc, doc->file_type);
+	return TRUE;
+}
 
-		document_update_tab_label(doc);
+/**
+ *  Saves the document.
+ *  Also shows the Save As dialog if necessary.
+ *  If the file is not modified, this function may do nothing unless @a force is set to @c TRUE.
+ *
+ *  Saving may include replacing tabs with spaces,
+ *  stripping trailing spaces and adding a final new line at the end of the file, depending
+ *  on user preferences. Then the @c "document-before-save" signal is emitted,
+ *  allowing plugins to modify the document before it is saved, and data is
+ *  actually written to disk.
+ *
+ *  On successful saving:
+ *  - GeanyDocument::real_path is set.
+ *  - The filetype is set again or auto-detected if it wasn't set yet.
+ *  - The @c "document-save" signal is emitted for plugins.
+ *
+ *  @warning You should ensure @c doc->file_name has an absolute path unless you want the
+ *  Save As dialog to be shown. A @c NULL value also shows the dialog. This behaviour was
+ *  added in Geany 1.22.
+ *
+ *  @param doc The document to save.
+ *  @param force Whether to save the file even if it is not modified.
+ *
+ *  @return @c TRUE if the file was saved or @c FALSE if the file could not or should not be saved.
+ **/
+GEANY_API_SYMBOL
+gboolean document_save_file(GeanyDocument *doc, gboolean force)
+{
+	return save_file(doc, force, FALSE);
+}
 
-		msgwin_status_add(_("File %s saved."), doc->file_name);
-		ui_update_statusbar(doc, -1);
-#ifdef HAVE_VTE
-		vte_cwd_document(doc, VTE_SHOW_DIR_NOT_CHANGED);
-#endif
+/* Like document_save_file(), but existing files may be written in the background if
+ * use_async_file_saving is set. Only for callers which don't rely on the file being written
+ * on return, i.e. the Save command; the result is reported when the write completes. */
+gboolean document_save_file_async(GeanyDocument *doc, gboolean force)
+{
+	return save_file(doc, force, TRUE);
+}
+
+/* State of the toolbar search, to skip searches which can't match and to count the matches
+ * in idle time slices */
+typedef struct
+{
+	guint		 doc_id;
+	guint		 text_changes;	/* doc->priv->text_changes, to notice changes of the text */
+	gchar		*text;
+	gboolean	 found;
+	gint		 match_start;	/* start of the selected match */
+	gint		 pos;			/* where to continue counting */
+	gint		 index;			/* number of the selected match, 0 if not counted yet */
+	gint		 count;
+	guint		 source_id;
+}
+SearchBarState;
+
+static SearchBarState search_bar_state;
+
+#define SEARCH_BAR_COUNT_CHUNK_SIZE (256 * 1024)
+#define SEARCH_BAR_COUNT_SLICE_USEC 8000
+
+static void search_bar_count_cancel(void)
+{
+	if (search_bar_state.source_id != 0)
+	{
+		g_source_remove(search_bar_state.source_id);
+		search_bar_state.source_id = 0;
 	}
-	g_free(locale_filename);
+}
 
-	g_signal_emit_by_name(geany_object, "document-save", doc);
+static void search_bar_state_clear(void)
+{
+	search_bar_count_cancel();
+	SETPTR(search_bar_state.text, NULL);
+}
 
-	return TRUE;
+static gboolean search_bar_count_idle(G_GNUC_UNUSED gpointer data)
+{
+	SearchBarState *state = &search_bar_state;
+	GeanyDocument *doc = document_get_current();
+	gint64 deadline = g_get_monotonic_time() + SEARCH_BAR_COUNT_SLICE_USEC;
+	ScintillaObject *sci;
+	gint length, text_len;
+
+	/* stop if the user switched documents or edited the text */
+	if (doc == NULL || doc->id != state->doc_id ||
+		doc->priv->text_changes != state->text_changes)
+	{
+		state->source_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	sci = doc->editor->sci;
+	length = sci_get_length(sci);
+	text_len = strlen(state->text);
+
+	while (state->pos < length && g_get_monotonic_time() < deadline)
+	{
+		struct Sci_TextToFind ttf;
+		gint end = MIN(state->pos + SEARCH_BAR_COUNT_CHUNK_SIZE, length);
+
+		/* matches starting in the chunk can end after it */
+		ttf.chrg.cpMin = state->pos;
+		ttf.chrg.cpMax = MIN(end + text_len - 1, length);
+		ttf.lpstrText = state->text;
+		state->pos = end;
+
+		while (sci_find_text(sci, 0, &ttf) != -1 && ttf.chrgText.cpMin < end)
+		{
+			state->count++;
+			if (ttf.chrgText.cpMin == state->match_start)
+				state->index = state->count;
+			ttf.chrg.cpMin = ttf.chrgText.cpMax;
+			state->pos = MAX(end, ttf.chrgText.cpMax);
+		}
+	}
+
+	if (state->index > 0)
+		ui_set_statusbar(FALSE, state->pos < length ? _("Match %d of %d+") : _("Match %d of %d"),
+			state->index, state->count);
+	else if (state->pos < length)
+		ui_set_statusbar(FALSE, _("Counting matches: %d"), state->count);
+	else
+	{
+		/* the selected match overlaps a counted one */
+		ui_set_statusbar(FALSE, ngettext("Found %d match for \"%s\".",
+			"Found %d matches for \"%s\".", state->count), state->count, state->text);
+	}
+
+	if (state->pos < length)
+		return G_SOURCE_CONTINUE;
+
+	state->source_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/* Remembers the search result and starts counting the matches if there are any */
+static void search_bar_update_state(GeanyDocument *doc, const gchar *text, gboolean found)
+{
+	SearchBarState *state = &search_bar_state;
+
+	search_bar_count_cancel();
+
+	state->doc_id = doc->id;
+	state->text_changes = doc->priv->text_changes;
+	SETPTR(state->text, g_strdup(text));
+	state->found = found;
+	if (! found)
+		return;
+
+	state->match_start = sci_get_selection_start(doc->editor->sci);
+	state->pos = 0;
+	state->index = 0;
+	state->count = 0;
+	state->source_id = g_idle_add(search_bar_count_idle, NULL);
 }
 
 /* special search function, used from the find entry in the toolbar
@@ -2722,31 +3788,45 @@ gboolean document_search_bar_find(GeanyDocument *doc, const gchar *text, gboolea
 	g_return_val_if_fail(text != NULL, FALSE);
 	g_return_val_if_fail(doc != NULL, FALSE);
 	if (! *text)
+	{
+		search_bar_count_cancel();
 		return TRUE;
+	}
 
 	start_pos = (inc || backwards) ? sci_get_selection_start(doc->editor->sci) :
 		sci_get_selection_end(doc->editor->sci);	/* equal if no selection */
 
-	/* search cursor to end or start */
-	ttf.chrg.cpMin = start_pos;
-	ttf.chrg.cpMax = backwards ? 0 : sci_get_length(doc->editor->sci);
-	ttf.lpstrText = (gchar *)text;
-	search_pos = sci_find_text(doc->editor->sci, 0, &ttf);
-
-	/* if no match, search start (or end) to cursor */
-	if (search_pos == -1)
+	/* when typing, an extension of a text that wasn't found can't be found either */
+	if (inc && ! search_bar_state.found && search_bar_state.text != NULL &&
+		search_bar_state.doc_id == doc->id &&
+		search_bar_state.text_changes == doc->priv->text_changes &&
+		g_str_has_prefix(text, search_bar_state.text))
 	{
-		if (backwards)
-		{
-			ttf.chrg.cpMin = sci_get_length(doc->editor->sci);
-			ttf.chrg.cpMax = start_pos;
-		}
-		else
+		search_pos = -1;
+	}
+	else
+	{
+		/* search cursor to end or start */
+		ttf.chrg.cpMin = start_pos;
+		ttf.chrg.cpMax = backwards ? 0 : sci_get_length(doc->editor->sci);
+		ttf.lpstrText = (gchar *)text;
+		search_pos = sci_find_text(doc->editor->sci, 0, &ttf);
+
+		/* if no match, search start (or end) to cursor */
+		if (search_pos == -1)
 		{
-			ttf.chrg.cpMin = 0;
-			ttf.chrg.cpMax = start_pos + strlen(text);
+			if (backwards)
+			{
+				ttf.chrg.cpMin = sci_get_length(doc->editor->sci);
+				ttf.chrg.cpMax = start_pos;
+			}
+			else
+			{
+				ttf.chrg.cpMin = 0;
+				ttf.chrg.cpMax = start_pos + strlen(text);
+			}
+			search_pos = sci_find_text(doc->editor->sci, 0, &ttf);
 		}
-		search_pos = sci_find_text(doc->editor->sci, 0, &ttf);
 	}
 
 	if (search_pos != -1)
@@ -2767,6 +3847,8 @@ gboolean document_search_bar_find(GeanyDocument *doc, const gchar *text, gboolea
 		}
 		else
 			sci_scroll_caret(doc->editor->sci); /* may need horizontal scrolling */
+
+		search_bar_update_state(doc, text, TRUE);
 		return TRUE;
 	}
 	else
@@ -2777,6 +3859,7 @@ gboolean document_search_bar_find(GeanyDocument *doc, const gchar *text, gboolea
 		}
 		utils_beep();
 		sci_goto_pos(doc->editor->sci, start_pos, FALSE);	/* clear selection */
+		search_bar_update_state(doc, text, FALSE);
 		return FALSE;
 	}
 }
@@ -3120,8 +4203,9 @@ void document_update_tags(GeanyDocument *doc)
 	g_return_if_fail(DOC_VALID(doc));
 	g_return_if_fail(app->tm_workspace != NULL);
 
-	/* early out if it's a new file or doesn't support tags */
-	if (! doc->file_name || ! doc->file_type || !filetype_has_tags(doc->file_type))
+	/* early out if it's a new file, a large file or doesn't support tags */
+	if (! doc->file_name || ! doc->file_type || !filetype_has_tags(doc->file_type) ||
+		doc->priv->large_file)
 	{
 		/* We must call sidebar_update_tag_list() before returning,
 		 * to ensure that the symbol list is always updated properly (e.g.
@@ -3165,6 +4249,42 @@ void document_update_tags(GeanyDocument *doc)
 	document_highlight_tags(doc);
 }
 
+/* Turns large file mode on or off for doc. It disables tags, folding, smart highlighting,
+ * brace highlighting and automatic document word completion. */
+void document_set_large_file(GeanyDocument *doc, gboolean large_file)
+{
+	ScintillaObject *sci;
+
+	g_return_if_fail(DOC_VALID(doc));
+
+	if (doc->priv->large_file == large_file)
+		return;
+
+	sci = doc->editor->sci;
+	doc->priv->large_file = large_file;
+	if (large_file)
+	{
+		/* don't leave lines hidden in folds */
+		scintilla_send_message(sci, SCI_FOLDALL, SC_FOLDACTION_EXPAND, 0);
+		sci_set_property(sci, "fold", "0");
+		scintilla_send_message(sci, SCI_BRACEHIGHLIGHT, (uptr_t) -1, -1);
+		if (doc->tm_file != NULL)
+		{
+			tm_workspace_remove_source_file(doc->tm_file);
+			tm_source_file_free(doc->tm_file);
+			doc->tm_file = NULL;
+		}
+	}
+	else
+		sci_set_property(sci, "fold", "1");
+
+	sci_set_folding_margin_visible(sci, editor_prefs.folding && ! large_file);
+	editor_update_smart_highlights(doc->editor);
+	document_update_tags(doc);
+	queue_colourise(doc);
+	ui_update_statusbar(doc, -1);
+}
+
 /* Re-highlights type keywords without re-parsing the whole document. */
 void document_highlight_tags(GeanyDocument *doc)
 {
@@ -3270,6 +4390,10 @@ static void document_load_config(GeanyDocument *doc, GeanyFiletype *type,
 			symbols_global_tags_loaded(type->id);
 
 		highlighting_set_styles(doc->editor->sci, type);
+		editor_set_layout_prefs(doc->editor);
+		/* folding a huge file takes too long */
+		if (doc->priv->large_file)
+			sci_set_property(doc->editor->sci, "fold", "0");
 		editor_set_indentation_guides(doc->editor);
 		build_menu_update(doc);
 		queue_colourise(doc);
@@ -3659,6 +4783,232 @@ static void document_redo_add(GeanyDocument *doc, guint type, gpointer data)
 	ui_update_popup_reundo_items(doc);
 }
 
+/* Scintilla's flag for undo actions merged with the following one, not in Scintilla.h */
+#define UNDO_ACTION_MAY_COALESCE 0x100
+/* rough size of Scintilla's bookkeeping for each undo action */
+#define UNDO_ACTION_OVERHEAD 16
+
+static guint undo_memory_check_source = 0;
+
+/* Returns an estimate of the memory used by the undo and redo history of doc, i.e. the text
+ * kept by Scintilla plus our own actions. */
+gsize document_get_undo_memory(GeanyDocument *doc)
+{
+	GTrashStack *stacks[] = { doc->priv->undo_actions, doc->priv->redo_actions };
+	ScintillaObject *sci = doc->editor->sci;
+	gint n_actions = sci_get_undo_actions(sci);
+	gsize size = 0;
+	guint i;
+	gint action;
+
+	for (action = 0; action < n_actions; action++)
+		size += sci_get_undo_action_text(sci, action, NULL) + UNDO_ACTION_OVERHEAD;
+
+	for (i = 0; i < G_N_ELEMENTS(stacks); i++)
+	{
+		GTrashStack *node;
+
+		for (node = stacks[i]; node != NULL; node = node->next)
+		{
+			undo_action *a = (undo_action *) node;
+
+			size += sizeof(undo_action);
+			if (a->type == UNDO_ENCODING && a->data != NULL)
+				size += strlen((const gchar *) a->data) + 1;
+			else if (a->type == UNDO_RELOAD)
+				size += sizeof(UndoReloadData);
+		}
+	}
+	return size;
+}
+
+
+/* Drops the first n_steps undo steps from Scintilla's history by rebuilding it from the
+ * remaining actions. Returns FALSE if the history doesn't match. */
+static gboolean drop_oldest_undo_steps(ScintillaObject *sci, guint n_steps)
+{
+	gint n_actions = sci_get_undo_actions(sci);
+	gint current = sci_get_undo_current(sci);
+	gint save_point, detach, tentative;
+	gint first, action;
+	guint steps = 0;
+	GArray *types, *positions;
+	GPtrArray *texts;
+	GArray *lengths;
+
+	if (n_steps == 0)
+		return TRUE;
+
+	/* an action starts a step unless the previous one may be coalesced with it */
+	for (first = 1; first < n_actions; first++)
+	{
+		if (! (sci_get_undo_action_type(sci, first - 1) & UNDO_ACTION_MAY_COALESCE) &&
+			++steps == n_steps)
+			break;
+	}
+	if (steps < n_steps)
+	{
+		if (steps + 1 != n_steps)
+			return FALSE;
+		first = n_actions;
+	}
+	/* the dropped steps must all be in the undo part of the history */
+	if (first > current)
+		return FALSE;
+
+	save_point = sci_get_undo_save_point(sci);
+	detach = sci_get_undo_detach(sci);
+	tentative = sci_get_undo_tentative(sci);
+
+	types = g_array_sized_new(FALSE, FALSE, sizeof(gint), n_actions - first);
+	positions = g_array_sized_new(FALSE, FALSE, sizeof(gint), n_actions - first);
+	lengths = g_array_sized_new(FALSE, FALSE, sizeof(gsize), n_actions - first);
+	texts = g_ptr_array_new_with_free_func(g_free);
+	for (action = first; action < n_actions; action++)
+	{
+		gint type = sci_get_undo_action_type(sci, action);
+		gint position = sci_get_undo_action_position(sci, action);
+		gsize len = sci_get_undo_action_text(sci, action, NULL);
+		gchar *text = g_malloc(len + 1);
+
+		sci_get_undo_action_text(sci, action, text);
+		g_array_append_val(types, type);
+		g_array_append_val(positions, position);
+		g_array_append_val(lengths, len);
+		g_ptr_array_add(texts, text);
+	}
+
+	sci_empty_undo_buffer(sci);
+	for (action = 0; action < n_actions - first; action++)
+	{
+		sci_push_undo_action(sci, g_array_index(types, gint, action),
+			g_array_index(positions, gint, action), g_ptr_array_index(texts, action),
+			g_array_index(lengths, gsize, action));
+	}
+	/* points in the dropped part can't be reached any more */
+	sci_set_undo_save_point(sci, save_point >= first ? save_point - first : -1);
+	sci_set_undo_detach(sci, detach >= first ? detach - first : -1);
+	sci_set_undo_tentative(sci, tentative >= first ? tentative - first : -1);
+	sci_set_undo_current(sci, current - first);
+
+	g_array_free(types, TRUE);
+	g_array_free(positions, TRUE);
+	g_array_free(lengths, TRUE);
+	g_ptr_array_free(texts, TRUE);
+	return TRUE;
+}
+
+
+/* Removes the oldest reload and everything before it from the undo history.
+ * Returns FALSE if there is no reload to remove. */
+static gboolean trim_oldest_reload(GeanyDocument *doc)
+{
+	GPtrArray *actions = g_ptr_array_new();
+	GTrashStack *node;
+	guint reload = G_MAXUINT;
+	guint n_steps = 0;
+	guint i;
+
+	/* the stack is linked from the newest action, so collect the actions first */
+	for (node = doc->priv->undo_actions; node != NULL; node = node->next)
+		g_ptr_array_add(actions, node);
+
+	for (i = actions->len; i > 0; i--)
+	{
+		undo_action *a = g_ptr_array_index(actions, i - 1);
+
+		if (a->type == UNDO_SCINTILLA)
+			n_steps++;
+		else if (a->type == UNDO_RELOAD)
+		{
+			reload = i - 1;
+			break;
+		}
+	}
+
+	if (reload == G_MAXUINT || ! drop_oldest_undo_steps(doc->editor->sci, n_steps))
+	{
+		g_ptr_array_free(actions, TRUE);
+		return FALSE;
+	}
+
+	/* cut the stack below the newer actions, then free the older ones */
+	if (reload > 0)
+		((GTrashStack *) g_ptr_array_index(actions, reload - 1))->next = NULL;
+	else
+		doc->priv->undo_actions = NULL;
+
+	node = g_ptr_array_index(actions, reload);
+	document_undo_clear_stack(&node);
+
+	g_ptr_array_free(actions, TRUE);
+
+	update_changed_state(doc);
+	ui_update_popup_reundo_items(doc);
+	return TRUE;
+}
+
+
+static gboolean check_undo_memory_idle(G_GNUC_UNUSED gpointer data)
+{
+	gsize doc_limit = (gsize) file_prefs.undo_memory_limit * 1024 * 1024;
+	gsize global_limit = (gsize) file_prefs.undo_memory_global_limit * 1024 * 1024;
+	gsize *sizes = g_new0(gsize, documents_array->len);
+	gboolean *exhausted = g_new0(gboolean, documents_array->len);
+	gsize total = 0;
+	guint i;
+
+	undo_memory_check_source = 0;
+
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+
+		sizes[i] = document_get_undo_memory(doc);
+		while (doc_limit > 0 && sizes[i] > doc_limit && trim_oldest_reload(doc))
+			sizes[i] = document_get_undo_memory(doc);
+		total += sizes[i];
+	}
+
+	/* trim the largest histories first to stay within the global budget */
+	while (global_limit > 0 && total > global_limit)
+	{
+		gint largest = -1;
+
+		foreach_document(i)
+		{
+			if (! exhausted[i] && (largest < 0 || sizes[i] > sizes[largest]))
+				largest = (gint) i;
+		}
+		if (largest < 0)
+			break;
+
+		if (trim_oldest_reload(documents[largest]))
+		{
+			total -= sizes[largest];
+			sizes[largest] = document_get_undo_memory(documents[largest]);
+			total += sizes[largest];
+		}
+		else
+			exhausted[largest] = TRUE;	/* no reloads left to trim */
+	}
+
+	g_free(sizes);
+	g_free(exhausted);
+	return G_SOURCE_REMOVE;
+}
+
+
+static void queue_undo_memory_check(void)
+{
+	if (undo_memory_check_source == 0 &&
+		(file_prefs.undo_memory_limit > 0 || file_prefs.undo_memory_global_limit > 0))
+	{
+		undo_memory_check_source = g_idle_add(check_undo_memory_idle, NULL);
+	}
+}
+
+
 enum
 {
 	STATUS_CHANGED,
@@ -3874,6 +5224,9 @@ gboolean document_account_for_unsaved(void)
 	{
 		GeanyDocument *doc = document_get_from_page(p);
 
+		if (DOC_VALID(doc))
+			document_finish_async_save(doc);
+
 		if (DOC_VALID(doc) && doc->changed)
 		{
 			if (! dialogs_show_unsaved_file(doc, &ignore_all))
@@ -4188,9 +5541,10 @@ gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
-	/* ignore remote files and documents that have never been saved to disk */
+	/* ignore remote files and documents that have never been saved to disk, and files which
+	 * are being written in the background */
 	if (notebook_switch_in_progress() || file_prefs.disk_check_timeout == 0
-			|| doc->real_path == NULL || doc->priv->is_remote)
+			|| doc->real_path == NULL || doc->priv->is_remote || doc->priv->async_save != NULL)
 		return FALSE;
 
 	use_gio_filemon = (doc->priv->monitor != NULL);
@@ -4200,6 +5554,15 @@ gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
 		if (doc->priv->file_disk_status != FILE_CHANGED && ! force)
 			return FALSE;
 	}
+	else if (dirwatch_is_watching(doc))
+	{
+		/* the directory watcher tells which files may have changed, so no need to poll */
+		if (! doc->priv->disk_dirty && ! force)
+			return FALSE;
+
+		doc->priv->disk_dirty = FALSE;
+		doc->priv->last_check = time(NULL);
+	}
 	else
 	{
 		time_t cur_time = time(NULL);
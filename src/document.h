@@ -65,6 +65,12 @@ typedef struct GeanyFilePrefs
 	gboolean		keep_edit_history_on_reload; /* Keep undo stack upon, and allow undoing of, document reloading. */
 	gboolean		show_keep_edit_history_on_reload_msg; /* whether to show the message introducing the above feature */
 	gint			default_new_file_dir;
+	gboolean		use_async_file_saving; /* convert and write saved files in a worker thread */
+	gboolean		use_directory_monitoring; /* watch directories instead of polling each file */
+	gint			large_file_threshold; /* in MiB, 0 to disable large file mode */
+	gint			undo_memory_limit; /* per document undo history budget in MiB, 0 for none */
+	gint			undo_memory_global_limit; /* undo history budget for all documents in MiB */
+	gint			large_file_line_length; /* in KiB, 0 to not check the line length */
 }
 GeanyFilePrefs;
 
@@ -304,12 +310,20 @@ void document_replace_sel(GeanyDocument *doc, const gchar *find_text, const gcha
 
 void document_update_tags(GeanyDocument *doc);
 
+void document_set_large_file(GeanyDocument *doc, gboolean large_file);
+
 void document_update_tag_list_in_idle(GeanyDocument *doc);
 
 void document_highlight_tags(GeanyDocument *doc);
 
 gboolean document_check_disk_status(GeanyDocument *doc, gboolean force);
 
+void document_finish_async_save(GeanyDocument *doc);
+
+gboolean document_save_file_async(GeanyDocument *doc, gboolean force);
+
+gsize document_get_undo_memory(GeanyDocument *doc);
+
 /* own Undo / Redo implementation to be able to undo / redo changes
  * to the encoding or the Unicode BOM (which are Scintilla independent).
  * All Scintilla events are stored in the undo / redo buffer and are passed through. */
@@ -108,6 +108,18 @@ typedef struct GeanyDocumentPrivate
 	time_t			 last_check;
 	/* Modification time of the document on disk, only used when legacy file monitoring is used. */
 	time_t			 mtime;
+	/* Size of the file on disk when it was last loaded or saved. */
+	goffset			 disk_size;
+	/* Path watched by dirwatch.c, NULL if the directory isn't watched. */
+	gchar			*watched_path;
+	/* Set by dirwatch.c when the file may have changed on disk. */
+	gboolean		 disk_dirty;
+	/* Whether the document is in large file mode, which disables features that are slow on
+	 * huge files. Set when the file exceeds file_prefs.large_file_threshold or has lines
+	 * longer than file_prefs.large_file_line_length, and from the Document menu. */
+	gboolean		 large_file;
+	/* Loader appending the rest of a large file in the background, NULL when done. */
+	gpointer		 large_file_loader;
 	/* ID of the idle callback updating the tag list */
 	guint			 tag_list_update_source;
 	/* Whether it's temporarily protected (read-only and saving needs confirmation). Does
@@ -128,6 +140,22 @@ typedef struct GeanyDocumentPrivate
 	gboolean		 favorite;
 	/* Document's iter for the favorites tree view */
 	GtkTreeIter		 iter_favorite;
+	/* Pending background save, only used when asynchronous file saving is enabled */
+	gpointer		 async_save;
+	/* Index of the document's words for completion, created on first use */
+	struct WordIndex *word_index;
+	/* Index of the document's matching braces, created on first use */
+	struct BraceIndex *brace_index;
+	/* Indentation statistics of the loaded text, only set while opening the file */
+	struct IndentStats *indent_stats;
+	/* Timeout folding the lines styled in the background after folding all, 0 if none */
+	guint			 fold_all_source;
+	/* The lines before this have been folded by the above */
+	gint			 fold_all_line;
+	/* The header at the base level whose children are being hidden by the above, or -1 */
+	gint			 fold_all_parent;
+	/* Incremented on each insertion or deletion, to notice changes of the text */
+	guint			 text_changes;
 }
 GeanyDocumentPrivate;
 
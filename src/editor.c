@@ -40,6 +40,7 @@
 #include "editor.h"
 
 #include "app.h"
+#include "braceindex.h"
 #include "callbacks.h"
 #include "dialogs.h"
 #include "documentprivate.h"
@@ -48,14 +49,17 @@
 #include "highlighting.h"
 #include "keybindings.h"
 #include "main.h"
+#include "msgwindow.h"
 #include "prefs.h"
 #include "projectprivate.h"
 #include "sciwrappers.h"
+#include "search.h"
+#include "snippets.h"
 #include "support.h"
 #include "symbols.h"
-#include "templates.h"
 #include "ui_utils.h"
 #include "utils.h"
+#include "wordindex.h"
 
 #include "SciLexer.h"
 
@@ -71,13 +75,13 @@
 #define SSM(s, m, w, l) scintilla_send_message(s, m, w, l)
 
 static GHashTable *snippet_hash = NULL;
+/* the compiled snippets, keyed on their strings in snippet_hash */
+static GHashTable *compiled_snippets = NULL;
 static GQueue *snippet_offsets = NULL;
 static gint snippet_cursor_insert_pos;
 static GtkAccelGroup *snippet_accel_group = NULL;
 static gboolean autocomplete_scope_shown = FALSE;
 
-static const gchar geany_cursor_marker[] = "__GEANY_CURSOR_MARKER__";
-
 /* holds word under the mouse or keyboard cursor */
 static gchar current_word[GEANY_MAX_WORD_LENGTH];
 
@@ -102,25 +106,44 @@ static void on_new_line_added(GeanyEditor *editor);
 static gboolean handle_xml(GeanyEditor *editor, gint pos, gchar ch);
 static void insert_indent_after_line(GeanyEditor *editor, gint line);
 static void auto_multiline(GeanyEditor *editor, gint pos);
-static void auto_close_chars(ScintillaObject *sci, gint pos, gchar c);
+static void auto_close_chars(GeanyEditor *editor, gint pos, gchar c);
 static void close_block(GeanyEditor *editor, gint pos);
 static void editor_highlight_braces(GeanyEditor *editor, gint cur_pos);
 static void read_current_word(GeanyEditor *editor, gint pos, gchar *word, gsize wordlen,
 		const gchar *wc, gboolean stem);
 static gsize count_indent_size(GeanyEditor *editor, const gchar *base_indent);
 static const gchar *snippets_find_completion_by_name(const gchar *type, const gchar *name);
-static void snippets_make_replacements(GeanyEditor *editor, GString *pattern);
-static gssize replace_cursor_markers(GeanyEditor *editor, GString *pattern);
 static GeanyFiletype *editor_get_filetype_at_line(GeanyEditor *editor, gint line);
 static gboolean sci_is_blank_line(ScintillaObject *sci, gint line);
+static void stop_fold_all(GeanyDocument *doc);
 
 void editor_snippets_free(void)
 {
+	g_hash_table_destroy(compiled_snippets);
 	g_hash_table_destroy(snippet_hash);
 	g_queue_free(snippet_offsets);
 	gtk_window_remove_accel_group(GTK_WINDOW(main_widgets.window), snippet_accel_group);
 }
 
+/* Compiles all snippets, so they aren't parsed again on every expansion */
+static void snippets_compile(void)
+{
+	GHashTable *specials = g_hash_table_lookup(snippet_hash, "Special");
+	GHashTableIter iter, group_iter;
+	gpointer group, value;
+
+	compiled_snippets = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+		(GDestroyNotify) snippet_free);
+
+	g_hash_table_iter_init(&iter, snippet_hash);
+	while (g_hash_table_iter_next(&iter, NULL, &group))
+	{
+		g_hash_table_iter_init(&group_iter, group);
+		while (g_hash_table_iter_next(&group_iter, NULL, &value))
+			g_hash_table_insert(compiled_snippets, value, snippet_compile(value, specials));
+	}
+}
+
 static void snippets_load(GKeyFile *sysconfig, GKeyFile *userconfig)
 {
 	gsize i, j, len = 0, len_keys = 0;
@@ -184,6 +207,8 @@ static void snippets_load(GKeyFile *sysconfig, GKeyFile *userconfig)
 		g_strfreev(keys_user);
 	}
 	g_strfreev(groups_user);
+
+	snippets_compile();
 }
 
 static void on_snippet_keybinding_activate(gchar *key)
@@ -492,11 +517,88 @@ static void on_margin_click(GeanyEditor *editor, SCNotification *nt)
 	}
 }
 
+/* Matches outside the visible lines are highlighted in idle time slices, so selecting a common
+ * word in a big file doesn't block. Only one document is highlighted at a time. */
+typedef struct SmartHighlightJob
+{
+	guint	 doc_id;
+	gchar	*text;
+	gint	 pos;		/* where to continue */
+	gint	 stop;		/* end of the current pass */
+	gint	 view_start;	/* start of the lines highlighted right away */
+	gboolean wrapped;	/* whether the pass from the start of the document to view_start started */
+	guint	 source_id;
+}
+SmartHighlightJob;
+
+static SmartHighlightJob smart_highlight_job;
+
+#define SMART_HIGHLIGHT_CHUNK_SIZE (64 * 1024)
+#define SMART_HIGHLIGHT_SLICE_USEC 8000
+
+static void smart_highlight_cancel(void)
+{
+	if (smart_highlight_job.source_id != 0)
+	{
+		g_source_remove(smart_highlight_job.source_id);
+		smart_highlight_job.source_id = 0;
+	}
+	SETPTR(smart_highlight_job.text, NULL);
+}
+
+static gboolean smart_highlight_idle(G_GNUC_UNUSED gpointer data)
+{
+	SmartHighlightJob *job = &smart_highlight_job;
+	GeanyDocument *doc = document_find_by_id(job->doc_id);
+	ScintillaObject *sci;
+	gint64 deadline;
+	gint doc_len;
+
+	if (doc == NULL)
+	{
+		job->source_id = 0;
+		smart_highlight_cancel();
+		return G_SOURCE_REMOVE;
+	}
+	sci = doc->editor->sci;
+	doc_len = sci_get_length(sci);
+	deadline = g_get_monotonic_time() + SMART_HIGHLIGHT_SLICE_USEC;
+
+	do
+	{
+		gint end;
+
+		/* the text may have changed since the last slice */
+		job->stop = MIN(job->stop, doc_len);
+		if (job->pos >= job->stop)
+		{
+			if (job->wrapped)
+			{
+				job->source_id = 0;
+				smart_highlight_cancel();
+				return G_SOURCE_REMOVE;
+			}
+			job->wrapped = TRUE;
+			job->pos = 0;
+			job->stop = job->view_start;
+			continue;
+		}
+		end = MIN(job->pos + SMART_HIGHLIGHT_CHUNK_SIZE, job->stop);
+		search_highlight_range(sci, job->text, GEANY_FIND_MATCHCASE,
+			GEANY_INDICATOR_SMART_HIGHLIGHT, FALSE, job->pos, end, &job->pos);
+	}
+	while (g_get_monotonic_time() < deadline);
+
+	return G_SOURCE_CONTINUE;
+}
+
 void editor_update_smart_highlights(GeanyEditor *editor)
 {
 	g_return_if_fail(editor != NULL);
 
-	if (!editor_prefs.smart_highlighting)
+	smart_highlight_cancel();
+
+	if (!editor_prefs.smart_highlighting || editor->document->priv->large_file)
 	{
 		editor_indicator_clear(editor, GEANY_INDICATOR_SMART_HIGHLIGHT);
 		return;
@@ -507,15 +609,39 @@ void editor_update_smart_highlights(GeanyEditor *editor)
 	gint start = sci_get_selection_start(sci);
 	gint end = sci_get_selection_end(sci);
 
+	editor_indicator_clear(editor, GEANY_INDICATOR_SMART_HIGHLIGHT);
 	if (end == start || !SSM(sci, SCI_ISRANGEWORD, (uptr_t) start, end))
-	{
-		editor_indicator_clear(editor, GEANY_INDICATOR_SMART_HIGHLIGHT);
 		return;
-	}
+
+	/* highlight the visible lines first */
+	gint first_line = SSM(sci, SCI_GETFIRSTVISIBLELINE, 0, 0);
+	gint last_line = first_line + SSM(sci, SCI_LINESONSCREEN, 0, 0);
+	gint view_start, view_end;
+
+	first_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, first_line, 0);
+	last_line = SSM(sci, SCI_DOCLINEFROMVISIBLE, last_line, 0);
+	view_start = sci_get_position_from_line(sci, first_line);
+	view_end = sci_get_line_end_position(sci, last_line);
 
 	gchar *text = sci_get_contents_range(sci, start, end);
-	search_highlight_all(sci, text, GEANY_FIND_MATCHCASE, GEANY_INDICATOR_SMART_HIGHLIGHT, FALSE);
-	g_free(text);
+	gint resume;
+
+	search_highlight_range(sci, text, GEANY_FIND_MATCHCASE, GEANY_INDICATOR_SMART_HIGHLIGHT,
+		FALSE, view_start, view_end, &resume);
+
+	/* then the rest of the document */
+	if (view_start > 0 || resume < sci_get_length(sci))
+	{
+		smart_highlight_job.doc_id = editor->document->id;
+		smart_highlight_job.text = text;
+		smart_highlight_job.pos = resume;
+		smart_highlight_job.stop = sci_get_length(sci);
+		smart_highlight_job.view_start = view_start;
+		smart_highlight_job.wrapped = FALSE;
+		smart_highlight_job.source_id = g_idle_add(smart_highlight_idle, NULL);
+	}
+	else
+		g_free(text);
 }
 
 static void on_update_ui(GeanyEditor *editor, G_GNUC_UNUSED SCNotification *nt)
@@ -758,7 +884,7 @@ static gboolean autocomplete_scope(GeanyEditor *editor, const gchar *root, gsize
 	brace_char = sci_get_char_at(sci, pos - 1);
 	if (pos > 0 && (brace_char == ')' || brace_char == ']'))
 	{
-		gint brace_pos = sci_find_matching_brace(sci, pos - 1);
+		gint brace_pos = editor_find_matching_brace(editor, pos - 1);
 
 		if (brace_pos != -1)
 		{
@@ -841,7 +967,7 @@ static void on_char_added(GeanyEditor *editor, SCNotification *nt)
 		}
 		case '(':
 		{
-			auto_close_chars(sci, pos, nt->ch);
+			auto_close_chars(editor, pos, nt->ch);
 			/* show calltips */
 			editor_show_calltip(editor, --pos);
 			break;
@@ -864,7 +990,7 @@ static void on_char_added(GeanyEditor *editor, SCNotification *nt)
 		case '"':
 		case '\'':
 		{
-			auto_close_chars(sci, pos, nt->ch);
+			auto_close_chars(editor, pos, nt->ch);
 			break;
 		}
 		case '}':
@@ -1058,6 +1184,93 @@ static gboolean check_partial_completion(GeanyEditor *editor, const gchar *entry
 	return FALSE;
 }
 
+/* Re-runs the first paint of a document with each of these settings, for --benchmark-painting */
+static const gint benchmark_idle_styling[] =
+	{ SC_IDLESTYLING_NONE, SC_IDLESTYLING_TOVISIBLE, SC_IDLESTYLING_ALL };
+static const gint benchmark_layout_cache[] = { SC_CACHE_CARET, SC_CACHE_PAGE, SC_CACHE_DOCUMENT };
+#define BENCHMARK_CONFIGS \
+	(G_N_ELEMENTS(benchmark_idle_styling) * G_N_ELEMENTS(benchmark_layout_cache))
+
+typedef struct PaintBenchmark
+{
+	guint	step;		/* index of the settings being measured, 2 * BENCHMARK_CONFIGS when done */
+	gint64	start;		/* time the styles and layouts were discarded, 0 until then */
+}
+PaintBenchmark;
+
+static void get_benchmark_settings(guint step, gint *idle_styling, gint *layout_cache,
+		gint *layout_threads)
+{
+	guint config = step % BENCHMARK_CONFIGS;
+
+	*idle_styling = benchmark_idle_styling[config % G_N_ELEMENTS(benchmark_idle_styling)];
+	*layout_cache = benchmark_layout_cache[config / G_N_ELEMENTS(benchmark_idle_styling)];
+	*layout_threads = step < BENCHMARK_CONFIGS ? 1 : utils_get_num_processors();
+}
+
+/* Idle callback, so the styles and layouts aren't discarded while painting */
+static gboolean start_paint_benchmark_step(gpointer data)
+{
+	ScintillaObject *sci = data;
+	PaintBenchmark *bench = g_object_get_data(G_OBJECT(sci), "geany-paint-benchmark");
+	gint idle_styling, layout_cache, layout_threads;
+
+	/* the document has been closed */
+	if (document_find_by_sci(sci) == NULL)
+		return G_SOURCE_REMOVE;
+
+	get_benchmark_settings(bench->step, &idle_styling, &layout_cache, &layout_threads);
+	SSM(sci, SCI_SETIDLESTYLING, idle_styling, 0);
+	SSM(sci, SCI_SETLAYOUTCACHE, layout_cache, 0);
+	SSM(sci, SCI_SETLAYOUTTHREADS, layout_threads, 0);
+
+	/* restyle from the start; unlike SCI_CLEARDOCUMENTSTYLE this keeps the fold levels */
+	SSM(sci, SCI_STARTSTYLING, 0, 0);
+	/* changing a style discards the cached line layouts */
+	SSM(sci, SCI_STYLESETSIZE, STYLE_DEFAULT, SSM(sci, SCI_STYLEGETSIZE, STYLE_DEFAULT, 0));
+
+	bench->start = g_get_monotonic_time();
+	gtk_widget_queue_draw(GTK_WIDGET(sci));
+	return G_SOURCE_REMOVE;
+}
+
+static void queue_paint_benchmark_step(GeanyEditor *editor, PaintBenchmark *bench)
+{
+	bench->start = 0;
+	g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, start_paint_benchmark_step,
+		g_object_ref(editor->sci), g_object_unref);
+}
+
+/* Called after each paint with --benchmark-painting. The first paint of a document starts the
+ * benchmark, and each following one reports the time of the current settings and starts the
+ * next ones. */
+static void on_paint_benchmark_painted(GeanyEditor *editor)
+{
+	PaintBenchmark *bench = g_object_get_data(G_OBJECT(editor->sci), "geany-paint-benchmark");
+	gint idle_styling, layout_cache, layout_threads;
+
+	if (bench == NULL)
+	{
+		bench = g_new0(PaintBenchmark, 1);
+		g_object_set_data_full(G_OBJECT(editor->sci), "geany-paint-benchmark", bench, g_free);
+		queue_paint_benchmark_step(editor, bench);
+		return;
+	}
+	/* ignore the paints before the next settings are applied and after the last ones */
+	if (bench->start == 0 || bench->step >= 2 * BENCHMARK_CONFIGS)
+		return;
+
+	get_benchmark_settings(bench->step, &idle_styling, &layout_cache, &layout_threads);
+	msgwin_status_add(_("Painting %s: idle styling %d, layout cache %d, %d layout threads: %.1f ms"),
+		DOC_FILENAME(editor->document), idle_styling, layout_cache, layout_threads,
+		(g_get_monotonic_time() - bench->start) / 1000.0);
+
+	if (++bench->step < 2 * BENCHMARK_CONFIGS)
+		queue_paint_benchmark_step(editor, bench);
+	else
+		editor_set_layout_prefs(editor);
+}
+
 /* Callback for the "sci-notify" signal to emit a "editor-notify" signal.
  * Plugins can connect to the "editor-notify" signal. */
 void editor_sci_notify_cb(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED gint scn,
@@ -1114,6 +1327,8 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 				/* disable further scrolling */
 				editor->scroll_percent = -1.0F;
 			}
+			if (G_UNLIKELY(cl_options.benchmark_painting))
+				on_paint_benchmark_painted(editor);
 			break;
 
  		case SCN_MODIFIED:
@@ -1127,15 +1342,28 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 				/* get notified about undo changes */
 				document_undo_add(doc, UNDO_SCINTILLA, NULL);
 			}
-			if (editor_prefs.folding && (nt->modificationType & SC_MOD_CHANGEFOLD) != 0)
+			/* the fold points of the lines styled in the background after folding all are
+			 * folded later, and edits would move the lines that have been folded already */
+			if (doc->priv->fold_all_source != 0 &&
+				(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+			{
+				stop_fold_all(doc);
+			}
+			if (editor_prefs.folding && (nt->modificationType & SC_MOD_CHANGEFOLD) != 0 &&
+				(doc->priv->fold_all_source == 0 || nt->line < doc->priv->fold_all_line))
 			{
 				/* handle special fold cases, e.g. #1923350 */
 				fold_changed(sci, nt->line, nt->foldLevelNow, nt->foldLevelPrev);
 			}
 			if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
 			{
+				doc->priv->text_changes++;
 				document_update_tag_list_in_idle(doc);
 			}
+			if (doc->priv->word_index != NULL)
+				wordindex_update(doc->priv->word_index, nt);
+			if (doc->priv->brace_index != NULL)
+				braceindex_update(doc->priv->brace_index, nt);
 			break;
 
 		case SCN_CHARADDED:
@@ -1509,13 +1737,14 @@ static void insert_indent_after_line(GeanyEditor *editor, gint line)
 	g_free(text);
 }
 
-static void auto_close_chars(ScintillaObject *sci, gint pos, gchar c)
+static void auto_close_chars(GeanyEditor *editor, gint pos, gchar c)
 {
+	ScintillaObject *sci = editor->sci;
 	const gchar *closing_char = NULL;
 	gint end_pos = -1;
 
 	if (utils_isbrace(c, 0))
-		end_pos = sci_find_matching_brace(sci, pos - 1);
+		end_pos = editor_find_matching_brace(editor, pos - 1);
 
 	switch (c)
 	{
@@ -1548,6 +1777,27 @@ static void auto_close_chars(ScintillaObject *sci, gint pos, gchar c)
 	}
 }
 
+static BraceIndex *get_brace_index(GeanyEditor *editor)
+{
+	GeanyDocument *doc = editor->document;
+
+	if (doc->priv->brace_index == NULL)
+		doc->priv->brace_index = braceindex_new(editor->sci);
+	return doc->priv->brace_index;
+}
+
+/* Like sci_find_matching_brace(), but uses the document's brace index when it covers pos */
+gint editor_find_matching_brace(GeanyEditor *editor, gint pos)
+{
+	gint match;
+
+	g_return_val_if_fail(editor != NULL, -1);
+
+	if (braceindex_find_match(get_brace_index(editor), pos, &match))
+		return match;
+	return sci_find_matching_brace(editor->sci, pos);
+}
+
 /* Finds a corresponding matching brace to the given pos
  * (this is taken from Scintilla Editor.cxx,
  * fit to work with close_block) */
@@ -1628,7 +1878,10 @@ static void close_block(GeanyEditor *editor, gint pos)
 
 	if (iprefs->auto_indent_mode == GEANY_AUTOINDENT_MATCHBRACES)
 	{
-		gint start_brace = brace_match(sci, pos);
+		gint start_brace;
+
+		if (! braceindex_find_match(get_brace_index(editor), pos, &start_brace))
+			start_brace = brace_match(sci, pos);
 
 		if (start_brace >= 0)
 		{
@@ -2002,7 +2255,7 @@ gboolean editor_show_calltip(GeanyEditor *editor, gint pos)
 	/* skip possible generic/template specification, like foo<int>() */
 	if (sci_get_char_at(sci, pos - 1) == '>')
 	{
-		pos = sci_find_matching_brace(sci, pos - 1);
+		pos = editor_find_matching_brace(editor, pos - 1);
 		if (pos == -1)
 			return FALSE;
 
@@ -2119,7 +2372,7 @@ static GSList *get_doc_words(ScintillaObject *sci, gchar *root, gsize rootlen)
 	flags = SCFIND_WORDSTART | SCFIND_MATCHCASE;
 
 	/* search the whole document for the word root and collect results */
-	pos_find = scintilla_send_message(sci, SCI_FINDTEXT, flags, (uptr_t) &ttf);
+	pos_find = search_find_literal(sci, flags, &ttf);
 	while (pos_find >= 0 && pos_find < len)
 	{
 		word_end = pos_find + rootlen;
@@ -2145,12 +2398,75 @@ static GSList *get_doc_words(ScintillaObject *sci, gchar *root, gsize rootlen)
 			}
 		}
 		ttf.chrg.cpMin = word_end;
-		pos_find = scintilla_send_message(sci, SCI_FINDTEXT, flags, (uptr_t) &ttf);
+		pos_find = search_find_literal(sci, flags, &ttf);
 	}
 
 	return g_slist_sort(words, (GCompareFunc)utils_str_casecmp);
 }
 
+static void add_index_words(gpointer key, G_GNUC_UNUSED gpointer value, gpointer user_data)
+{
+	GSList **words = user_data;
+
+	*words = g_slist_prepend(*words, key);
+}
+
+/* Gets the words matching root from the word index of the document, and of the other open
+ * documents of the same filetype if enabled.
+ * @returns FALSE if the document's index isn't ready yet */
+static gboolean get_indexed_words(GeanyEditor *editor, const gchar *root, gsize rootlen,
+		GSList **words)
+{
+	GeanyDocument *doc = editor->document;
+	GHashTable *found;
+	gchar *current_word;
+	gint current;
+	guint i;
+
+	if (doc->priv->word_index == NULL)
+		doc->priv->word_index = wordindex_new(editor->sci);
+	if (! wordindex_is_ready(doc->priv->word_index) ||
+		! wordindex_is_word(doc->priv->word_index, root))
+	{
+		return FALSE;
+	}
+
+	/* the word being typed is only offered if it occurs elsewhere */
+	current = sci_get_current_position(editor->sci);
+	current_word = sci_get_contents_range(editor->sci, current - (gint) rootlen,
+		sci_word_end_position(editor->sci, current, TRUE));
+
+	/* the table takes the words, which are then owned by the list */
+	found = g_hash_table_new(g_str_hash, g_str_equal);
+	wordindex_find_prefix(doc->priv->word_index, root, current_word, found,
+		editor_prefs.autocompletion_max_entries);
+	g_free(current_word);
+
+	if (editor_prefs.complete_other_doc_words)
+	{
+		foreach_document(i)
+		{
+			GeanyDocument *other = documents[i];
+
+			if (other == doc || other->file_type != doc->file_type || other->priv->large_file)
+				continue;
+			if (other->priv->word_index == NULL)
+				other->priv->word_index = wordindex_new(other->editor->sci);
+			if (wordindex_is_ready(other->priv->word_index))
+			{
+				wordindex_find_prefix(other->priv->word_index, root, NULL, found,
+					editor_prefs.autocompletion_max_entries);
+			}
+		}
+	}
+
+	*words = NULL;
+	g_hash_table_foreach(found, add_index_words, words);
+	g_hash_table_destroy(found);
+	*words = g_slist_sort(*words, (GCompareFunc)utils_str_casecmp);
+	return TRUE;
+}
+
 static gboolean autocomplete_doc_word(GeanyEditor *editor, gchar *root, gsize rootlen)
 {
 	ScintillaObject *sci = editor->sci;
@@ -2158,7 +2474,9 @@ static gboolean autocomplete_doc_word(GeanyEditor *editor, gchar *root, gsize ro
 	GString *str;
 	guint n_words = 0;
 
-	words = get_doc_words(sci, root, rootlen);
+	/* scan the document while its word index is being built */
+	if (! get_indexed_words(editor, root, rootlen, &words))
+		words = get_doc_words(sci, root, rootlen);
 	if (!words)
 	{
 		scintilla_send_message(sci, SCI_AUTOCCANCEL, 0, 0);
@@ -2264,7 +2582,8 @@ gboolean editor_start_auto_complete(GeanyEditor *editor, gint pos, gboolean forc
 					ret = autocomplete_tags(editor, editor->document->file_type, root, rootlen);
 
 				/* If forcing and there's nothing else to show, complete from words in document */
-				if (!ret && (force || editor_prefs.autocomplete_doc_words))
+				if (!ret && (force || (editor_prefs.autocomplete_doc_words &&
+					! editor->document->priv->large_file)))
 					ret = autocomplete_doc_word(editor, root, rootlen);
 			}
 		}
@@ -2303,52 +2622,53 @@ static const gchar *snippets_find_completion_by_name(const gchar *type, const gc
 	return result;
 }
 
-static void snippets_replace_specials(gpointer key, gpointer value, gpointer user_data)
+/* Inserts snippet at insert_pos and places the cursor at its first cursor position, or after
+ * it. The offsets to the other cursor positions are saved for
+ * editor_goto_next_snippet_cursor(). */
+static void insert_snippet(GeanyEditor *editor, const Snippet *snippet, gint insert_pos,
+		gint newline_indent_size)
 {
-	gchar *needle;
-	GString *pattern = user_data;
-
-	g_return_if_fail(key != NULL);
-	g_return_if_fail(value != NULL);
-
-	needle = g_strconcat("%", (gchar*) key, "%", NULL);
+	ScintillaObject *sci = editor->sci;
+	GArray *cursors = g_array_new(FALSE, FALSE, sizeof(gint));
+	gchar *text;
+	gint idx;
+	guint i;
 
-	utils_string_replace_all(pattern, needle, (gchar*) value);
-	g_free(needle);
-}
+	if (newline_indent_size == -1)
+	{
+		/* count indent size up to insert_pos instead of asking sci
+		 * because there may be spaces after it */
+		gint line_start = sci_get_line_from_position(sci, insert_pos);
+		gchar *tmp = sci_get_line(sci, line_start);
 
-static void fix_indentation(GeanyEditor *editor, GString *buf)
-{
-	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(editor);
-	gchar *whitespace;
-	GRegex *regex;
-	gint cflags = G_REGEX_MULTILINE;
+		idx = insert_pos - sci_get_position_from_line(sci, line_start);
+		tmp[idx] = '\0';
+		newline_indent_size = count_indent_size(editor, tmp);
+		g_free(tmp);
+	}
 
-	/* transform leading tabs into indent widths (in spaces) */
-	whitespace = g_strnfill(iprefs->width, ' ');
-	regex = g_regex_new("^ *(\t)", cflags, 0, NULL);
-	while (utils_string_regex_replace_all(buf, regex, 1, whitespace, TRUE));
-	g_regex_unref(regex);
+	text = snippet_expand(snippet, editor, newline_indent_size, cursors);
+	sci_insert_text(sci, insert_pos, text);
 
-	/* remaining tabs are for alignment */
-	if (iprefs->type != GEANY_INDENT_TYPE_TABS)
-		utils_string_replace_all(buf, "\t", whitespace);
+	/* if there's no cursor, skip the whole snippet */
+	idx = cursors->len > 0 ? g_array_index(cursors, gint, 0) : (gint) strlen(text);
+	sci_set_current_position(sci, insert_pos + idx, FALSE);
+	snippet_cursor_insert_pos = sci_get_current_position(sci);
 
-	/* use leading tabs */
-	if (iprefs->type != GEANY_INDENT_TYPE_SPACES)
+	/* put the relative offsets to the cursor positions of the most recent snippet first,
+	 * followed by any remaining ones */
+	for (i = 1; i < cursors->len; i++)
 	{
-		gchar *str;
+		gint offset = g_array_index(cursors, gint, i) - g_array_index(cursors, gint, i - 1);
 
-		/* for tabs+spaces mode we want the real tab width, not indent width */
-		SETPTR(whitespace, g_strnfill(sci_get_tab_width(editor->sci), ' '));
-		str = g_strdup_printf("^\t*(%s)", whitespace);
-
-		regex = g_regex_new(str, cflags, 0, NULL);
-		while (utils_string_regex_replace_all(buf, regex, 1, "\t", TRUE));
-		g_regex_unref(regex);
-		g_free(str);
+		g_queue_push_nth(snippet_offsets, GINT_TO_POINTER(offset), i - 1);
 	}
-	g_free(whitespace);
+	/* limit length of queue */
+	while (g_queue_get_length(snippet_offsets) > 20)
+		g_queue_pop_tail(snippet_offsets);
+
+	g_array_free(cursors, TRUE);
+	g_free(text);
 }
 
 /** Inserts text, replacing \\t tab chars (@c 0x9) and \\n newline chars (@c 0xA)
@@ -2373,63 +2693,16 @@ GEANY_API_SYMBOL
 void editor_insert_text_block(GeanyEditor *editor, const gchar *text, gint insert_pos,
 		gint cursor_index, gint newline_indent_size, gboolean replace_newlines)
 {
-	ScintillaObject *sci = editor->sci;
-	gint line_start = sci_get_line_from_position(sci, insert_pos);
-	GString *buf;
-	const gchar *eol = editor_get_eol_char(editor);
-	gint idx;
+	Snippet *snippet;
 
 	g_return_if_fail(text);
 	g_return_if_fail(editor != NULL);
 	g_return_if_fail(insert_pos >= 0);
 
-	buf = g_string_new(text);
-
-	if (cursor_index >= 0)
-		g_string_insert(buf, cursor_index, geany_cursor_marker);	/* remember cursor pos */
-
-	if (newline_indent_size == -1)
-	{
-		/* count indent size up to insert_pos instead of asking sci
-		 * because there may be spaces after it */
-		gchar *tmp = sci_get_line(sci, line_start);
-
-		idx = insert_pos - sci_get_position_from_line(sci, line_start);
-		tmp[idx] = '\0';
-		newline_indent_size = count_indent_size(editor, tmp);
-		g_free(tmp);
-	}
-
-	/* Add line indents (in spaces) */
-	if (newline_indent_size > 0)
-	{
-		const gchar *nl = replace_newlines ? "\n" : eol;
-		gchar *whitespace;
-
-		whitespace = g_strnfill(newline_indent_size, ' ');
-		SETPTR(whitespace, g_strconcat(nl, whitespace, NULL));
-		utils_string_replace_all(buf, nl, whitespace);
-		g_free(whitespace);
-	}
-
-	/* transform line endings */
-	if (replace_newlines)
-		utils_string_replace_all(buf, "\n", eol);
-
-	fix_indentation(editor, buf);
-
-	idx = replace_cursor_markers(editor, buf);
-	if (idx >= 0)
-	{
-		sci_insert_text(sci, insert_pos, buf->str);
-		sci_set_current_position(sci, insert_pos + idx, FALSE);
-	}
-	else
-		sci_insert_text(sci, insert_pos, buf->str);
-
-	snippet_cursor_insert_pos = sci_get_current_position(sci);
-
-	g_string_free(buf, TRUE);
+	snippet = snippet_compile_text_block(text, cursor_index,
+		replace_newlines ? "\n" : editor_get_eol_char(editor));
+	insert_snippet(editor, snippet, insert_pos, newline_indent_size);
+	snippet_free(snippet);
 }
 
 /* Move the cursor to the next specified cursor position in an inserted snippet.
@@ -2457,84 +2730,6 @@ void editor_goto_next_snippet_cursor(GeanyEditor *editor)
 	}
 }
 
-static void snippets_make_replacements(GeanyEditor *editor, GString *pattern)
-{
-	GHashTable *specials;
-
-	/* replace 'special' completions */
-	specials = g_hash_table_lookup(snippet_hash, "Special");
-	if (G_LIKELY(specials != NULL))
-	{
-		g_hash_table_foreach(specials, snippets_replace_specials, pattern);
-	}
-
-	/* now transform other wildcards */
-	utils_string_replace_all(pattern, "%newline%", "\n");
-	utils_string_replace_all(pattern, "%ws%", "\t");
-
-	/* replace %cursor% by a very unlikely string marker */
-	utils_string_replace_all(pattern, "%cursor%", geany_cursor_marker);
-
-	/* unescape '%' after all %wildcards% */
-	templates_replace_valist(pattern, "{pc}", "%", NULL);
-
-	/* replace any template {foo} wildcards */
-	templates_replace_common(pattern, editor->document->file_name, editor->document->file_type, NULL);
-}
-
-static gssize replace_cursor_markers(GeanyEditor *editor, GString *pattern)
-{
-	gssize cur_index = -1;
-	gint i;
-	GList *temp_list = NULL;
-	gint cursor_steps = 0, old_cursor = 0;
-
-	i = 0;
-	while (1)
-	{
-		cursor_steps = utils_string_find(pattern, cursor_steps, -1, geany_cursor_marker);
-		if (cursor_steps == -1)
-			break;
-
-		g_string_erase(pattern, cursor_steps, strlen(geany_cursor_marker));
-
-		if (i++ > 0)
-		{
-			/* save the relative offset to each cursor position */
-			temp_list = g_list_prepend(temp_list, GINT_TO_POINTER(cursor_steps - old_cursor));
-		}
-		else
-		{
-			/* first cursor already includes newline positions */
-			cur_index = cursor_steps;
-		}
-		old_cursor = cursor_steps;
-	}
-
-	/* put the cursor positions for the most recent
-	 * parsed snippet first, followed by any remaining positions */
-	i = 0;
-	if (temp_list)
-	{
-		GList *node;
-
-		temp_list = g_list_reverse(temp_list);
-		foreach_list(node, temp_list)
-			g_queue_push_nth(snippet_offsets, node->data, i++);
-
-		/* limit length of queue */
-		while (g_queue_get_length(snippet_offsets) > 20)
-			g_queue_pop_tail(snippet_offsets);
-
-		g_list_free(temp_list);
-	}
-	/* if there's no first cursor, skip whole snippet */
-	if (cur_index < 0)
-		cur_index = pattern->len;
-
-	return cur_index;
-}
-
 static gboolean snippets_complete_constructs(GeanyEditor *editor, gint pos, const gchar *word)
 {
 	ScintillaObject *sci = editor->sci;
@@ -3357,7 +3552,7 @@ static gboolean delay_match_brace(G_GNUC_UNUSED gpointer user_data)
 		editor_highlight_braces(editor, cur_pos);
 		return FALSE;
 	}
-	end_pos = sci_find_matching_brace(editor->sci, brace_pos);
+	end_pos = editor_find_matching_brace(editor, brace_pos);
 
 	if (end_pos >= 0)
 	{
@@ -3381,6 +3576,9 @@ static void editor_highlight_braces(GeanyEditor *editor, gint cur_pos)
 	SSM(editor->sci, SCI_SETHIGHLIGHTGUIDE, 0, 0);
 	SSM(editor->sci, SCI_BRACEBADLIGHT, (uptr_t)-1, 0);
 
+	if (editor->document->priv->large_file)
+		return;
+
 	if (! utils_isbrace(sci_get_char_at(editor->sci, brace_pos), editor_prefs.brace_match_ltgt))
 	{
 		brace_pos++;
@@ -3953,6 +4151,7 @@ void editor_indentation_by_one_space(GeanyEditor *editor, gint pos, gboolean dec
 
 void editor_finalize(void)
 {
+	smart_highlight_cancel();
 	scintilla_release_resources();
 }
 
@@ -4252,26 +4451,118 @@ const gchar *editor_get_eol_char(GeanyEditor *editor)
 	return utils_get_eol_char(mode);
 }
 
-static void fold_all(GeanyEditor *editor, gboolean want_fold)
+/* Contracts the fold points of the lines from first to before last and hides the children of
+ * the headers at the base level, like SCI_FOLDALL does for the whole document. The children
+ * are found like Document::GetLastChild() does, but one line at a time, keeping the open
+ * header in doc->priv->fold_all_parent. */
+static void fold_lines(GeanyDocument *doc, gint first, gint last)
 {
-	gint lines, first, i;
+	ScintillaObject *sci = doc->editor->sci;
+	gint line, hidden = -1;
 
-	if (editor == NULL || ! editor_prefs.folding)
-		return;
+	for (line = first; line < last; line++)
+	{
+		gint level = sci_get_fold_level(sci, line);
+		gint number = level & SC_FOLDLEVELNUMBERMASK;
+		gint parent = doc->priv->fold_all_parent;
+
+		if (parent >= 0 && ((level & SC_FOLDLEVELWHITEFLAG) || number > SC_FOLDLEVELBASE))
+		{
+			if (hidden < 0)
+				hidden = line;
+		}
+		else
+		{
+			if (hidden >= 0)
+			{
+				SSM(sci, SCI_HIDELINES, hidden, line - 1);
+				hidden = -1;
+			}
+			/* a trailing blank line belongs to the parent's parent */
+			if (parent >= 0 && number < SC_FOLDLEVELBASE && line - 1 > parent &&
+				(sci_get_fold_level(sci, line - 1) & SC_FOLDLEVELWHITEFLAG))
+			{
+				SSM(sci, SCI_SHOWLINES, line - 1, line - 1);
+			}
+			doc->priv->fold_all_parent = -1;
+		}
+
+		if (level & SC_FOLDLEVELHEADERFLAG)
+		{
+			SSM(sci, SCI_SETFOLDEXPANDED, line, 0);
+			if (number == SC_FOLDLEVELBASE)
+				doc->priv->fold_all_parent = line;
+		}
+	}
+	if (hidden >= 0)
+		SSM(sci, SCI_HIDELINES, hidden, last - 1);
+}
 
-	lines = sci_get_line_count(editor->sci);
-	first = sci_get_first_visible_line(editor->sci);
+/* Folds the lines the background styling has reached since the last call */
+static gboolean fold_all_lazily(gpointer data)
+{
+	GeanyDocument *doc = data;
+	ScintillaObject *sci = doc->editor->sci;
+	gint end_styled = SSM(sci, SCI_GETENDSTYLED, 0, 0);
+	gint lines = sci_get_line_count(sci);
+	/* the fold level of the line of end_styled isn't known yet */
+	gint styled_lines = end_styled >= sci_get_length(sci) ? lines :
+		sci_get_line_from_position(sci, end_styled);
 
-	for (i = 0; i < lines; i++)
+	if (styled_lines > doc->priv->fold_all_line)
 	{
-		gint level = sci_get_fold_level(editor->sci, i);
+		fold_lines(doc, doc->priv->fold_all_line, styled_lines);
+		doc->priv->fold_all_line = styled_lines;
+	}
+	if (styled_lines < lines)
+		return G_SOURCE_CONTINUE;
 
-		if (level & SC_FOLDLEVELHEADERFLAG)
+	doc->priv->fold_all_source = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/* Stops folding the lines styled in the background, e.g. when the text changes */
+static void stop_fold_all(GeanyDocument *doc)
+{
+	if (doc->priv->fold_all_source != 0)
+	{
+		g_source_remove(doc->priv->fold_all_source);
+		doc->priv->fold_all_source = 0;
+	}
+}
+
+static void fold_all(GeanyEditor *editor, gboolean want_fold)
+{
+	ScintillaObject *sci;
+	GeanyDocument *doc;
+	gint first;
+
+	if (editor == NULL || ! editor_prefs.folding)
+		return;
+
+	sci = editor->sci;
+	doc = editor->document;
+	first = sci_get_first_visible_line(sci);
+	stop_fold_all(doc);
+
+	if (! want_fold)
+		SSM(sci, SCI_FOLDALL, SC_FOLDACTION_EXPAND, 0);
+	else if (SSM(sci, SCI_GETIDLESTYLING, 0, 0) >= SC_IDLESTYLING_AFTERVISIBLE &&
+		SSM(sci, SCI_GETENDSTYLED, 0, 0) < sci_get_length(sci))
+	{
+		/* SCI_FOLDALL would style the whole document first, instead fold the styled lines
+		 * now and the others when the background styling reaches them */
+		doc->priv->fold_all_line = 0;
+		doc->priv->fold_all_parent = -1;
+		if (fold_all_lazily(doc))
 		{
-			if (sci_get_fold_expanded(editor->sci, i) == want_fold)
-					sci_toggle_fold(editor->sci, i);
+			doc->priv->fold_all_source = g_timeout_add_full(G_PRIORITY_LOW, 100,
+				fold_all_lazily, doc, NULL);
 		}
 	}
+	else
+		SSM(sci, SCI_FOLDALL, SC_FOLDACTION_CONTRACT | SC_FOLDACTION_CONTRACT_EVERY_LEVEL, 0);
+
 	editor_scroll_to_line(editor, first, 0.0F);
 }
 
@@ -4285,70 +4576,195 @@ void editor_fold_all(GeanyEditor *editor)
 	fold_all(editor, TRUE);
 }
 
-void editor_replace_tabs(GeanyEditor *editor, gboolean ignore_selection)
+/* A replacement of part of the text for the whitespace transforms */
+typedef struct
+{
+	gint	pos;
+	gint	len;
+	gint	repl_offset;	/* offset of the replacement text in the replacements string */
+	gint	repl_len;
+}
+WhitespaceEdit;
+
+/* edits on the same line closer than this are applied as one replacement */
+#define WHITESPACE_EDIT_MERGE_GAP 4096
+
+static void add_whitespace_edit(GArray *edits, GString *repl, gint pos, gint len,
+		gchar repl_char, gint repl_len)
+{
+	WhitespaceEdit edit;
+	gint i;
+
+	edit.pos = pos;
+	edit.len = len;
+	edit.repl_offset = repl->len;
+	edit.repl_len = repl_len;
+	for (i = 0; i < repl_len; i++)
+		g_string_append_c(repl, repl_char);
+	g_array_append_val(edits, edit);
+}
+
+/* Maps a position to where it is after the edits */
+static gint map_whitespace_edits(GArray *edits, gint pos)
+{
+	gint delta = 0;
+	guint i;
+
+	for (i = 0; i < edits->len; i++)
+	{
+		WhitespaceEdit *edit = &g_array_index(edits, WhitespaceEdit, i);
+
+		if (edit->pos >= pos)
+			break;
+		if (pos >= edit->pos + edit->len)
+			delta += edit->repl_len - edit->len;
+		else
+			return edit->pos + delta + MIN(pos - edit->pos, edit->repl_len);
+	}
+	return pos + delta;
+}
+
+/* Applies the edits, which are sorted by position, as one undo action. Edits on the same line
+ * are merged into one replacement, but replacements never span line ends, so markers, folds
+ * and indicators of the lines stay where they are, also when undoing. */
+static void apply_whitespace_edits(GeanyEditor *editor, GArray *edits, GString *repl)
 {
+	ScintillaObject *sci = editor->sci;
+	GString *text;
 	gint anchor_pos, caret_pos;
-	struct Sci_TextToFind ttf;
+	guint i, j, k;
 
-	g_return_if_fail(editor != NULL);
+	if (edits->len == 0)
+		return;
 
-	sci_start_undo_action(editor->sci);
+	anchor_pos = map_whitespace_edits(edits, SSM(sci, SCI_GETANCHOR, 0, 0));
+	caret_pos = map_whitespace_edits(edits, sci_get_current_position(sci));
+
+	sci_start_undo_action(sci);
+	text = g_string_new(NULL);
+	/* replace from the end, so the positions of the edits before stay valid */
+	for (j = edits->len; j > 0; j = i)
+	{
+		WhitespaceEdit *last = &g_array_index(edits, WhitespaceEdit, j - 1);
+		const gchar *range_text;
+		gint start, pos;
+
+		/* replace edits i to j - 1 together */
+		for (i = j - 1; i > 0; i--)
+		{
+			WhitespaceEdit *prev = &g_array_index(edits, WhitespaceEdit, i - 1);
+			gint gap_start = prev->pos + prev->len;
+			gint gap_len = g_array_index(edits, WhitespaceEdit, i).pos - gap_start;
+			const gchar *gap;
+
+			if (gap_len > WHITESPACE_EDIT_MERGE_GAP)
+				break;
+			gap = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, gap_start, gap_len);
+			if (memchr(gap, '\n', gap_len) != NULL || memchr(gap, '\r', gap_len) != NULL)
+				break;
+		}
+
+		start = g_array_index(edits, WhitespaceEdit, i).pos;
+		/* the gap of the buffer is behind the range after replacing from the end, so this
+		 * doesn't move any text */
+		range_text = (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start,
+			last->pos + last->len - start);
+		pos = start;
+		g_string_truncate(text, 0);
+		for (k = i; k < j; k++)
+		{
+			WhitespaceEdit *edit = &g_array_index(edits, WhitespaceEdit, k);
+
+			g_string_append_len(text, range_text + pos - start, edit->pos - pos);
+			g_string_append_len(text, repl->str + edit->repl_offset, edit->repl_len);
+			pos = edit->pos + edit->len;
+		}
+		sci_set_target_start(sci, start);
+		sci_set_target_end(sci, pos);
+		SSM(sci, SCI_REPLACETARGET, text->len, (sptr_t) text->str);
+	}
+	g_string_free(text, TRUE);
+
+	/* unlike SCI_SETSEL, this doesn't scroll, e.g. when stripping spaces on saving */
+	SSM(sci, SCI_SETANCHOR, anchor_pos, 0);
+	SSM(sci, SCI_SETCURRENTPOS, caret_pos, 0);
+	sci_end_undo_action(sci);
+}
+
+/* Gets the range to transform, the selection or the whole document */
+static void get_whitespace_range(GeanyEditor *editor, gboolean ignore_selection,
+		gint *start, gint *end)
+{
 	if (sci_has_selection(editor->sci) && !ignore_selection)
 	{
-		ttf.chrg.cpMin = sci_get_selection_start(editor->sci);
-		ttf.chrg.cpMax = sci_get_selection_end(editor->sci);
+		*start = sci_get_selection_start(editor->sci);
+		*end = sci_get_selection_end(editor->sci);
 	}
 	else
 	{
-		ttf.chrg.cpMin = 0;
-		ttf.chrg.cpMax = sci_get_length(editor->sci);
+		*start = 0;
+		*end = sci_get_length(editor->sci);
 	}
-	ttf.lpstrText = (gchar*) "\t";
+}
 
-	anchor_pos = SSM(editor->sci, SCI_GETANCHOR, 0, 0);
-	caret_pos = sci_get_current_position(editor->sci);
-	while (TRUE)
+void editor_replace_tabs(GeanyEditor *editor, gboolean ignore_selection)
+{
+	const gchar *text;
+	GArray *edits;
+	GString *repl;
+	gint start, end, pos, col, tab_len;
+
+	g_return_if_fail(editor != NULL);
+
+	get_whitespace_range(editor, ignore_selection, &start, &end);
+	tab_len = sci_get_tab_width(editor->sci);
+	col = sci_get_col_from_position(editor->sci, start);
+	text = sci_get_character_pointer(editor->sci);
+	edits = g_array_new(FALSE, FALSE, sizeof(WhitespaceEdit));
+	repl = g_string_new(NULL);
+
+	for (pos = start; pos < end; pos++)
 	{
-		gint search_pos, pos_in_line, current_tab_true_length;
-		gint tab_len;
-		gchar *tab_str;
+		guchar c = text[pos];
 
-		search_pos = sci_find_text(editor->sci, SCFIND_MATCHCASE, &ttf);
-		if (search_pos == -1)
-			break;
+		if (c == '\t')
+		{
+			gint width = tab_len - (col % tab_len);
 
-		tab_len = sci_get_tab_width(editor->sci);
-		pos_in_line = sci_get_col_from_position(editor->sci, search_pos);
-		current_tab_true_length = tab_len - (pos_in_line % tab_len);
-		tab_str = g_strnfill(current_tab_true_length, ' ');
-		sci_set_target_start(editor->sci, search_pos);
-		sci_set_target_end(editor->sci, search_pos + 1);
-		sci_replace_target(editor->sci, tab_str, FALSE);
-		/* next search starts after replacement */
-		ttf.chrg.cpMin = search_pos + current_tab_true_length - 1;
-		/* update end of range now text has changed */
-		ttf.chrg.cpMax += current_tab_true_length - 1;
-		g_free(tab_str);
-
-		if (anchor_pos > search_pos)
-			anchor_pos += current_tab_true_length - 1;
-		if (caret_pos > search_pos)
-			caret_pos += current_tab_true_length - 1;
-	}
-	sci_set_selection(editor->sci, anchor_pos, caret_pos);
-	sci_end_undo_action(editor->sci);
+			add_whitespace_edit(edits, repl, pos, 1, ' ', width);
+			col += width;
+		}
+		else if (c == '\r' || c == '\n')
+			col = 0;
+		/* UTF-8 continuation bytes don't start a new column */
+		else if ((c & 0xC0) != 0x80)
+			col++;
+	}
+
+	apply_whitespace_edits(editor, edits, repl);
+	g_array_free(edits, TRUE);
+	g_string_free(repl, TRUE);
+}
+
+static void add_indent_spaces_edit(GArray *edits, GString *repl, gint run_start, gint run_end,
+		gint tab_len)
+{
+	gint n_tabs = (run_end - run_start) / tab_len;
+
+	if (n_tabs > 0)
+		add_whitespace_edit(edits, repl, run_start, n_tabs * tab_len, '\t', n_tabs);
 }
 
 /* Replaces all occurrences all spaces of the length of a given tab_width,
  * optionally restricting the search to the current selection. */
 void editor_replace_spaces(GeanyEditor *editor, gboolean ignore_selection)
 {
-	gint search_pos;
-	gint anchor_pos, caret_pos;
 	static gdouble tab_len_f = -1.0; /* keep the last used value */
-	gint tab_len;
-	gchar *text;
-	struct Sci_TextToFind ttf;
+	const gchar *text;
+	GArray *edits;
+	GString *repl;
+	gint tab_len, start, end, pos, run_start = -1;
+	gboolean in_indent;
 
 	g_return_if_fail(editor != NULL);
 
@@ -4363,50 +4779,39 @@ void editor_replace_spaces(GeanyEditor *editor, gboolean ignore_selection)
 		return;
 	}
 	tab_len = (gint) tab_len_f;
-	text = g_strnfill(tab_len, ' ');
 
-	sci_start_undo_action(editor->sci);
-	if (sci_has_selection(editor->sci) && !ignore_selection)
-	{
-		ttf.chrg.cpMin = sci_get_selection_start(editor->sci);
-		ttf.chrg.cpMax = sci_get_selection_end(editor->sci);
-	}
-	else
-	{
-		ttf.chrg.cpMin = 0;
-		ttf.chrg.cpMax = sci_get_length(editor->sci);
-	}
-	ttf.lpstrText = text;
+	get_whitespace_range(editor, ignore_selection, &start, &end);
+	text = sci_get_character_pointer(editor->sci);
+	edits = g_array_new(FALSE, FALSE, sizeof(WhitespaceEdit));
+	repl = g_string_new(NULL);
 
-	anchor_pos = SSM(editor->sci, SCI_GETANCHOR, 0, 0);
-	caret_pos = sci_get_current_position(editor->sci);
-	while (TRUE)
+	/* only replace indentation because otherwise we can mess up alignment */
+	in_indent = start <= sci_get_line_indent_position(editor->sci,
+		sci_get_line_from_position(editor->sci, start));
+	for (pos = start; pos < end; pos++)
 	{
-		search_pos = sci_find_text(editor->sci, SCFIND_MATCHCASE, &ttf);
-		if (search_pos == -1)
-			break;
-		/* only replace indentation because otherwise we can mess up alignment */
-		if (search_pos > sci_get_line_indent_position(editor->sci,
-			sci_get_line_from_position(editor->sci, search_pos)))
+		gchar c = text[pos];
+
+		if (c == ' ')
 		{
-			ttf.chrg.cpMin = search_pos + tab_len;
+			if (in_indent && run_start < 0)
+				run_start = pos;
 			continue;
 		}
-		sci_set_target_start(editor->sci, search_pos);
-		sci_set_target_end(editor->sci, search_pos + tab_len);
-		sci_replace_target(editor->sci, "\t", FALSE);
-		ttf.chrg.cpMin = search_pos;
-		/* update end of range now text has changed */
-		ttf.chrg.cpMax -= tab_len - 1;
-
-		if (anchor_pos > search_pos)
-			anchor_pos -= tab_len - 1;
-		if (caret_pos > search_pos)
-			caret_pos -= tab_len - 1;
-	}
-	sci_set_selection(editor->sci, anchor_pos, caret_pos);
-	sci_end_undo_action(editor->sci);
-	g_free(text);
+		if (run_start >= 0)
+			add_indent_spaces_edit(edits, repl, run_start, pos, tab_len);
+		run_start = -1;
+		if (c == '\r' || c == '\n')
+			in_indent = TRUE;
+		else if (c != '\t')
+			in_indent = FALSE;
+	}
+	if (run_start >= 0)
+		add_indent_spaces_edit(edits, repl, run_start, end, tab_len);
+
+	apply_whitespace_edits(editor, edits, repl);
+	g_array_free(edits, TRUE);
+	g_string_free(repl, TRUE);
 }
 
 void editor_strip_line_trailing_spaces(GeanyEditor *editor, gint line)
@@ -4435,9 +4840,15 @@ void editor_strip_line_trailing_spaces(GeanyEditor *editor, gint line)
 
 void editor_strip_trailing_spaces(GeanyEditor *editor, gboolean ignore_selection)
 {
-	gint start_line;
-	gint end_line;
-	gint line;
+	const gchar *text;
+	GArray *edits;
+	GString *repl;
+	gint start_line, end_line;
+	gint start, end, pos, run_start = -1;
+
+	/* Diff hunks should keep trailing spaces */
+	if (sci_get_lexer(editor->sci) == SCLEX_DIFF)
+		return;
 
 	if (sci_has_selection(editor->sci) && !ignore_selection)
 	{
@@ -4456,13 +4867,34 @@ void editor_strip_trailing_spaces(GeanyEditor *editor, gboolean ignore_selection
 		end_line = sci_get_line_count(editor->sci);
 	}
 
-	sci_start_undo_action(editor->sci);
+	start = sci_get_position_from_line(editor->sci, start_line);
+	end = end_line < sci_get_line_count(editor->sci) ?
+		sci_get_position_from_line(editor->sci, end_line) : sci_get_length(editor->sci);
+	text = sci_get_character_pointer(editor->sci);
+	edits = g_array_new(FALSE, FALSE, sizeof(WhitespaceEdit));
+	repl = g_string_new(NULL);
 
-	for (line = start_line; line < end_line; line++)
+	for (pos = start; pos < end; pos++)
 	{
-		editor_strip_line_trailing_spaces(editor, line);
+		gchar c = text[pos];
+
+		if (c == ' ' || c == '\t')
+		{
+			if (run_start < 0)
+				run_start = pos;
+			continue;
+		}
+		if ((c == '\r' || c == '\n') && run_start >= 0)
+			add_whitespace_edit(edits, repl, run_start, pos - run_start, ' ', 0);
+		run_start = -1;
 	}
-	sci_end_undo_action(editor->sci);
+	/* the last line has no line ending */
+	if (run_start >= 0 && end == sci_get_length(editor->sci))
+		add_whitespace_edit(edits, repl, run_start, end - run_start, ' ', 0);
+
+	apply_whitespace_edits(editor, edits, repl);
+	g_array_free(edits, TRUE);
+	g_string_free(repl, TRUE);
 }
 
 void editor_ensure_final_newline_unless_empty(GeanyEditor *editor)
@@ -4648,10 +5080,13 @@ static gboolean editor_check_colourise(GeanyEditor *editor)
 		return FALSE;
 
 	doc->priv->colourise_needed = FALSE;
-	sci_colourise(editor->sci, 0, -1);
+	/* with any idle styling, Scintilla styles the document in the background */
+	if (SSM(editor->sci, SCI_GETIDLESTYLING, 0, 0) == SC_IDLESTYLING_NONE)
+		sci_colourise(editor->sci, 0, -1);
 
-	/* now that the current document is colourised, fold points are now accurate,
-	 * so force an update of the current function/tag. */
+	/* force an update of the current function/tag. Without idle styling the document is
+	 * colourised now, so fold points are accurate; with it, only the styled part is, and
+	 * the update only sees what has been styled so far. */
 	symbols_get_current_function(NULL, NULL);
 	ui_update_statusbar(NULL, -1);
 
@@ -5045,7 +5480,7 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	sci_set_symbol_margin(sci, editor_prefs.show_markers_margin);
 	sci_set_line_numbers(sci, editor_prefs.show_linenumber_margin);
 
-	sci_set_folding_margin_visible(sci, editor_prefs.folding);
+	sci_set_folding_margin_visible(sci, editor_prefs.folding && ! editor->document->priv->large_file);
 
 	/* virtual space */
 	SSM(sci, SCI_SETVIRTUALSPACEOPTIONS, editor_prefs.show_virtual_space, 0);
@@ -5060,6 +5495,33 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	sci_set_scroll_stop_at_last_line(sci, editor_prefs.scroll_stop_at_last_line);
 
 	sci_set_scrollbar_mode(sci, editor_prefs.show_scrollbars);
+
+	editor_set_layout_prefs(editor);
+}
+
+/* Applies the idle styling and layout prefs, which filetypes can override */
+void editor_set_layout_prefs(GeanyEditor *editor)
+{
+	GeanyFiletype *ft = editor->document->file_type;
+	gint idle_styling = editor_prefs.idle_styling;
+	gint layout_cache = editor_prefs.layout_cache;
+	gint layout_threads = editor_prefs.layout_threads;
+
+	if (ft != NULL && ft->priv->keyfile_loaded)
+	{
+		if (ft->priv->idle_styling >= 0)
+			idle_styling = ft->priv->idle_styling;
+		if (ft->priv->layout_cache >= 0)
+			layout_cache = ft->priv->layout_cache;
+		if (ft->priv->layout_threads >= 0)
+			layout_threads = ft->priv->layout_threads;
+	}
+	if (layout_threads <= 0)
+		layout_threads = utils_get_num_processors();
+
+	SSM(editor->sci, SCI_SETIDLESTYLING, idle_styling, 0);
+	SSM(editor->sci, SCI_SETLAYOUTCACHE, layout_cache, 0);
+	SSM(editor->sci, SCI_SETLAYOUTTHREADS, layout_threads, 0);
 }
 
 /* This is for tab-indents, space aligns formatted code. Spaces should be preserved. */
@@ -5186,12 +5648,21 @@ const gchar *editor_find_snippet(GeanyEditor *editor, const gchar *snippet_name)
 GEANY_API_SYMBOL
 void editor_insert_snippet(GeanyEditor *editor, gint pos, const gchar *snippet)
 {
-	GString *pattern;
+	Snippet *compiled;
 
-	pattern = g_string_new(snippet);
-	snippets_make_replacements(editor, pattern);
-	editor_insert_text_block(editor, pattern->str, pos, -1, -1, TRUE);
-	g_string_free(pattern, TRUE);
+	g_return_if_fail(editor != NULL);
+	g_return_if_fail(snippet != NULL);
+
+	/* the snippets from snippet_hash are compiled already */
+	compiled = g_hash_table_lookup(compiled_snippets, snippet);
+	if (compiled != NULL)
+		insert_snippet(editor, compiled, pos, -1);
+	else
+	{
+		compiled = snippet_compile(snippet, g_hash_table_lookup(snippet_hash, "Special"));
+		insert_snippet(editor, compiled, pos, -1);
+		snippet_free(compiled);
+	}
 }
 
 static void        *copy_(void *src) { return src; }
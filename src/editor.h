@@ -138,6 +138,10 @@ typedef struct GeanyEditorPrefs
 	gint		autocompletion_update_freq;
 	gint		scroll_lines_around_cursor;
 	gboolean	smart_highlighting;
+	gboolean	complete_other_doc_words;	/* also complete words of same filetype docs */
+	gint		idle_styling;		/* SC_IDLESTYLING_* */
+	gint		layout_cache;		/* SC_CACHE_* */
+	gint		layout_threads;		/* threads for laying out lines, 0 for one per processor */
 }
 GeanyEditorPrefs;
 
@@ -326,12 +330,16 @@ void editor_set_indentation_guides(GeanyEditor *editor);
 
 void editor_apply_update_prefs(GeanyEditor *editor);
 
+void editor_set_layout_prefs(GeanyEditor *editor);
+
 gchar *editor_get_calltip_text(GeanyEditor *editor, const TMTag *tag);
 
 void editor_toggle_fold(GeanyEditor *editor, gint line, gint modifiers);
 
 void editor_update_smart_highlights(GeanyEditor *editor);
 
+gint editor_find_matching_brace(GeanyEditor *editor, gint pos);
+
 #endif /* GEANY_PRIVATE */
 
 G_END_DECLS
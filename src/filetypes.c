@@ -931,6 +931,12 @@ static void load_settings(guint ft_id, GKeyFile *config, GKeyFile *configh)
 		"symbol_list_sort_mode", SYMBOLS_SORT_USE_PREVIOUS);
 	ft->priv->xml_indent_tags = utils_get_setting(boolean, configh, config, "settings",
 		"xml_indent_tags", FALSE);
+	ft->priv->idle_styling = utils_get_setting(integer, configh, config, "settings",
+		"idle_styling", -1);
+	ft->priv->layout_cache = utils_get_setting(integer, configh, config, "settings",
+		"layout_cache", -1);
+	ft->priv->layout_threads = utils_get_setting(integer, configh, config, "settings",
+		"layout_threads", -1);
 
 	/* read indent settings */
 	load_indent_settings(ft, config, configh);
@@ -38,6 +38,10 @@ typedef struct GeanyFiletypePrivate
 	gboolean	custom;
 	gint		symbol_list_sort_mode;
 	gboolean	xml_indent_tags; /* XML tag autoindentation, for HTML and XML filetypes */
+	/* overrides of the editor prefs, -1 to use those */
+	gint		idle_styling;
+	gint		layout_cache;
+	gint		layout_threads;
 	GSList		*tag_files;
 	gboolean	warn_color_scheme;
 
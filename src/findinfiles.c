@@ -0,0 +1,723 @@
+/*
+ *      findinfiles.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Built-in Find in Files engine.
+ *
+ * Directories and files are searched by a pool of worker threads, each directory queuing its
+ * subdirectories and files as new tasks. Files are memory mapped, binary files are skipped
+ * and .gitignore files are honoured. Documents with unsaved changes are searched instead of
+ * their file on disk. Matches are collected per file and added to the messages window in
+ * batches from the main thread. Inside the project base path, the project's search index is
+ * used to skip files which can't contain the search text.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "findinfiles.h"
+
+#include "document.h"
+#include "msgwindow.h"
+#include "sciwrappers.h"
+#include "searchindex.h"
+#include "support.h"
+#include "ui_utils.h"
+#include "utils.h"
+
+#include "tm_source_file.h"
+
+#include "gtkcompat.h"
+
+#include <string.h>
+/* gstdio.h also includes sys/stat.h */
+#include <glib/gstdio.h>
+
+/* files with a NUL byte in this many first bytes are considered binary, like grep does */
+#define BINARY_CHECK_SIZE 32768
+/* interval for adding the collected matches to the messages window, in milliseconds */
+#define FLUSH_INTERVAL 100
+
+
+typedef struct IgnoreRule
+{
+	GPatternSpec	*spec;
+	gboolean		 negate;
+	gboolean		 dir_only;
+	gboolean		 anchored;	/* match the path relative to the .gitignore, not the name */
+}
+IgnoreRule;
+
+/* rules of a .gitignore file, linked to the ones of the parent directories */
+typedef struct IgnoreList
+{
+	gint				 ref_count;
+	struct IgnoreList	*parent;
+	gchar				*base;
+	GArray				*rules;
+}
+IgnoreList;
+
+typedef struct SearchTask
+{
+	gchar		*path;
+	gboolean	 is_dir;
+	IgnoreList	*ignore;
+	gint64		 mtime;			/* for files */
+	gint64		 size;
+}
+SearchTask;
+
+typedef struct SearchState
+{
+	GThreadPool	*pool;
+	GRegex		*regex;			/* for UTF-8 text */
+	GRegex		*raw_regex;		/* for text in the chosen encoding or invalid UTF-8 */
+	gchar		*literal;		/* text that must be present for a match, or NULL */
+	gchar		*raw_literal;
+	const gchar	*enc;
+	gboolean	 invert;
+	gboolean	 recursive;
+	GPtrArray	*patterns;
+	gchar		*root;			/* real path of the searched directory, with a trailing separator */
+	gsize		 root_len;
+	GHashTable	*snapshots;		/* real path -> text of documents with unsaved changes */
+	SearchIndex	*index;			/* project index covering root, or NULL */
+	GArray		*trigrams;		/* trigrams a file must contain for a match, or NULL */
+	gint		 pending;		/* queued and running tasks */
+	gint		 cancelled;
+	GMutex		 lock;			/* protects results and n_matches */
+	GPtrArray	*results;
+	guint		 n_matches;
+	guint		 flush_source;
+}
+SearchState;
+
+
+static SearchState *current_search = NULL;
+
+
+static IgnoreList *ignore_list_ref(IgnoreList *list)
+{
+	if (list != NULL)
+		g_atomic_int_inc(&list->ref_count);
+	return list;
+}
+
+
+static void ignore_list_unref(IgnoreList *list)
+{
+	while (list != NULL && g_atomic_int_dec_and_test(&list->ref_count))
+	{
+		IgnoreList *parent = list->parent;
+		guint i;
+
+		for (i = 0; i < list->rules->len; i++)
+			g_pattern_spec_free(g_array_index(list->rules, IgnoreRule, i).spec);
+		g_array_free(list->rules, TRUE);
+		g_free(list->base);
+		g_free(list);
+		list = parent;
+	}
+}
+
+
+/* Returns a new reference to the rules for dir_path, which are the parent's if there's no
+ * .gitignore file. Only the basic syntax is supported: globs, negation, and patterns anchored
+ * by a slash or limited to directories by a trailing slash. */
+static IgnoreList *ignore_list_load(const gchar *dir_path, IgnoreList *parent)
+{
+	gchar *filename = g_build_filename(dir_path, ".gitignore", NULL);
+	gchar *contents;
+	gchar **lines, **line;
+	IgnoreList *list;
+
+	if (! g_file_get_contents(filename, &contents, NULL, NULL))
+	{
+		g_free(filename);
+		return ignore_list_ref(parent);
+	}
+	g_free(filename);
+
+	list = g_new0(IgnoreList, 1);
+	list->ref_count = 1;
+	list->parent = ignore_list_ref(parent);
+	list->base = g_strdup(dir_path);
+	list->rules = g_array_new(FALSE, FALSE, sizeof(IgnoreRule));
+
+	lines = g_strsplit(contents, "\n", -1);
+	foreach_strv(line, lines)
+	{
+		gchar *pattern = g_strstrip(*line);
+		IgnoreRule rule = { NULL, FALSE, FALSE, FALSE };
+		gsize len;
+
+		if (*pattern == '\0' || *pattern == '#')
+			continue;
+
+		if (*pattern == '!')
+		{
+			rule.negate = TRUE;
+			pattern++;
+		}
+		len = strlen(pattern);
+		if (len > 0 && pattern[len - 1] == '/')
+		{
+			rule.dir_only = TRUE;
+			pattern[len - 1] = '\0';
+		}
+		if (*pattern == '/')
+		{
+			rule.anchored = TRUE;
+			pattern++;
+		}
+		else
+			rule.anchored = strchr(pattern, '/') != NULL;
+
+		if (*pattern == '\0')
+			continue;
+
+		rule.spec = g_pattern_spec_new(pattern);
+		g_array_append_val(list->rules, rule);
+	}
+	g_strfreev(lines);
+	g_free(contents);
+
+	if (list->rules->len == 0)
+	{
+		ignore_list_unref(list);
+		return ignore_list_ref(parent);
+	}
+	return list;
+}
+
+
+static gboolean is_ignored(IgnoreList *list, const gchar *path, gboolean is_dir)
+{
+	for (; list != NULL; list = list->parent)
+	{
+		gchar *rel_path = g_strdup(path + strlen(list->base) + 1);
+		const gchar *name = strrchr(rel_path, G_DIR_SEPARATOR);
+		gint ignored = -1;
+		guint i;
+
+		name = (name != NULL) ? name + 1 : rel_path;
+#ifdef G_OS_WIN32
+		g_strdelimit(rel_path, G_DIR_SEPARATOR_S, '/');
+#endif
+		/* the last matching rule wins */
+		for (i = 0; i < list->rules->len; i++)
+		{
+			IgnoreRule *rule = &g_array_index(list->rules, IgnoreRule, i);
+
+			if (rule->dir_only && ! is_dir)
+				continue;
+			if (g_pattern_match_string(rule->spec, rule->anchored ? rel_path : name))
+				ignored = ! rule->negate;
+		}
+		g_free(rel_path);
+
+		/* rules closer to the file take precedence */
+		if (ignored >= 0)
+			return ignored;
+	}
+	return FALSE;
+}
+
+
+static gboolean is_vcs_dir(const gchar *name)
+{
+	return utils_str_equal(name, ".git") || utils_str_equal(name, ".svn") ||
+		utils_str_equal(name, ".hg") || utils_str_equal(name, ".bzr") ||
+		utils_str_equal(name, "CVS");
+}
+
+
+static gboolean matches_patterns(SearchState *state, const gchar *name)
+{
+	guint i;
+
+	if (state->patterns->len == 0)
+		return TRUE;
+
+	for (i = 0; i < state->patterns->len; i++)
+	{
+		if (g_pattern_match_string(state->patterns->pdata[i], name))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static void push_task(SearchState *state, gchar *path, gboolean is_dir, IgnoreList *ignore,
+		const GStatBuf *st)
+{
+	SearchTask *task = g_new(SearchTask, 1);
+
+	task->path = path;
+	task->is_dir = is_dir;
+	task->ignore = ignore_list_ref(ignore);
+	task->mtime = st != NULL ? searchindex_get_mtime(st) : 0;
+	task->size = st != NULL ? st->st_size : 0;
+
+	g_atomic_int_inc(&state->pending);
+	g_thread_pool_push(state->pool, task, NULL);
+}
+
+
+/* memchr() is vectorized by most C libraries, so look for the first byte with it and only
+ * compare the rest at the candidates */
+static gboolean contains_literal(const gchar *data, gsize len, const gchar *literal)
+{
+	gsize literal_len = strlen(literal);
+	const gchar *end = data + len;
+	const gchar *p = data;
+
+	while ((gsize) (end - p) >= literal_len &&
+		(p = memchr(p, literal[0], end - p - literal_len + 1)) != NULL)
+	{
+		if (memcmp(p, literal, literal_len) == 0)
+			return TRUE;
+		p++;
+	}
+	return FALSE;
+}
+
+
+static void add_match(GPtrArray *matches, const gchar *rel_path, gint line,
+		const gchar *text, gsize len, const gchar *enc)
+{
+	gchar *utf8_text = NULL;
+
+	if (len > 0 && text[len - 1] == '\r')
+		len--;
+
+	/* only matching lines are converted */
+	if (enc != NULL)
+		utf8_text = g_convert(text, len, "UTF-8", enc, NULL, NULL, NULL);
+
+	if (utf8_text != NULL)
+		g_ptr_array_add(matches, g_strdup_printf("%s:%d:%s", rel_path, line, utf8_text));
+	else
+		g_ptr_array_add(matches, g_strdup_printf("%s:%d:%.*s", rel_path, line, (gint) len, text));
+	g_free(utf8_text);
+}
+
+
+static void search_buffer(SearchState *state, const gchar *path, const gchar *data, gsize len,
+		gboolean is_snapshot)
+{
+	/* documents are always UTF-8, files only if no other encoding was chosen */
+	gboolean utf8 = is_snapshot || (state->enc == NULL && g_utf8_validate(data, len, NULL));
+	GRegex *regex = utf8 ? state->regex : state->raw_regex;
+	const gchar *literal = utf8 ? state->literal : state->raw_literal;
+	const gchar *enc = is_snapshot ? NULL : state->enc;
+	const gchar *rel_path = path + state->root_len;
+	GPtrArray *matches;
+	const gchar *nl;
+	gsize line_start = 0, line_end;
+	gint line = 1;
+
+	/* GRegex uses gint offsets */
+	if (len > G_MAXINT)
+		return;
+	if (literal != NULL && ! contains_literal(data, len, literal))
+		return;
+
+	matches = g_ptr_array_new();
+	if (state->invert)
+	{
+		for (; line_start < len && ! g_atomic_int_get(&state->cancelled); line++)
+		{
+			nl = memchr(data + line_start, '\n', len - line_start);
+			line_end = (nl != NULL) ? (gsize) (nl - data) : len;
+
+			if (! g_regex_match_full(regex, data, line_end, line_start, 0, NULL, NULL))
+				add_match(matches, rel_path, line, data + line_start, line_end - line_start, enc);
+			line_start = line_end + 1;
+		}
+	}
+	else
+	{
+		gsize pos = 0;
+
+		/* match on the whole buffer and only look at the lines with a match */
+		while (pos < len && ! g_atomic_int_get(&state->cancelled))
+		{
+			GMatchInfo *info;
+			gint start, end;
+
+			if (! g_regex_match_full(regex, data, len, pos, 0, &info, NULL))
+			{
+				g_match_info_free(info);
+				break;
+			}
+			g_match_info_fetch_pos(info, 0, &start, &end);
+			g_match_info_free(info);
+
+			while ((nl = memchr(data + line_start, '\n', start - line_start)) != NULL)
+			{
+				line_start = nl - data + 1;
+				line++;
+			}
+			nl = memchr(data + start, '\n', len - start);
+			line_end = (nl != NULL) ? (gsize) (nl - data) : len;
+
+			/* like grep, don't let matches span lines */
+			if ((gsize) end <= line_end ||
+				g_regex_match_full(regex, data, line_end, start, 0, NULL, NULL))
+			{
+				add_match(matches, rel_path, line, data + line_start, line_end - line_start, enc);
+			}
+			pos = line_end + 1;
+		}
+	}
+
+	if (matches->len > 0)
+	{
+		g_mutex_lock(&state->lock);
+		state->n_matches += matches->len;
+		g_ptr_array_set_size(state->results, state->results->len + matches->len);
+		memcpy(state->results->pdata + state->results->len - matches->len, matches->pdata,
+			matches->len * sizeof(gpointer));
+		g_mutex_unlock(&state->lock);
+	}
+	g_ptr_array_free(matches, TRUE);
+}
+
+
+static void search_file(SearchState *state, SearchTask *task)
+{
+	const gchar *path = task->path;
+	const gchar *snapshot = g_hash_table_lookup(state->snapshots, path);
+	SearchIndexResult indexed = SEARCH_INDEX_MAYBE;
+	GMappedFile *file;
+	const gchar *data;
+	gsize len;
+	gboolean binary;
+
+	if (snapshot != NULL)
+	{
+		search_buffer(state, path, snapshot, strlen(snapshot), TRUE);
+		return;
+	}
+
+	if (state->index != NULL)
+	{
+		indexed = searchindex_lookup(state->index, path, task->mtime, task->size, state->trigrams);
+		if (indexed == SEARCH_INDEX_NO_MATCH || indexed == SEARCH_INDEX_BINARY)
+			return;
+	}
+
+	file = g_mapped_file_new(path, FALSE, NULL);
+	if (file == NULL)
+		return;
+
+	data = g_mapped_file_get_contents(file);
+	len = g_mapped_file_get_length(file);
+	binary = data != NULL && memchr(data, '\0', MIN(len, BINARY_CHECK_SIZE)) != NULL;
+	if (indexed == SEARCH_INDEX_UNKNOWN)
+		searchindex_update(state->index, path, task->mtime, task->size, data, len, binary);
+	if (data != NULL && ! binary)
+		search_buffer(state, path, data, len, FALSE);
+
+	g_mapped_file_unref(file);
+}
+
+
+static void search_dir(SearchState *state, SearchTask *task)
+{
+	GDir *dir = g_dir_open(task->path, 0, NULL);
+	IgnoreList *ignore;
+	const gchar *name;
+
+	if (dir == NULL)
+		return;
+
+	ignore = ignore_list_load(task->path, task->ignore);
+	while ((name = g_dir_read_name(dir)) != NULL && ! g_atomic_int_get(&state->cancelled))
+	{
+		gchar *path = g_build_filename(task->path, name, NULL);
+		GStatBuf st;
+
+		/* symbolic links aren't followed, like with grep -r */
+		if (g_lstat(path, &st) != 0)
+			g_free(path);
+		else if (S_ISDIR(st.st_mode))
+		{
+			if (state->recursive && ! is_vcs_dir(name) && ! is_ignored(ignore, path, TRUE))
+				push_task(state, path, TRUE, ignore, NULL);
+			else
+				g_free(path);
+		}
+		else if (S_ISREG(st.st_mode) && matches_patterns(state, name) &&
+			! is_ignored(ignore, path, FALSE))
+		{
+			push_task(state, path, FALSE, NULL, &st);
+		}
+		else
+			g_free(path);
+	}
+	ignore_list_unref(ignore);
+	g_dir_close(dir);
+}
+
+
+static void run_task(gpointer data, gpointer user_data)
+{
+	SearchTask *task = data;
+	SearchState *state = user_data;
+
+	/* cancelled tasks are only freed */
+	if (! g_atomic_int_get(&state->cancelled))
+	{
+		if (task->is_dir)
+			search_dir(state, task);
+		else
+			search_file(state, task);
+	}
+	ignore_list_unref(task->ignore);
+	g_free(task->path);
+	g_free(task);
+
+	g_atomic_int_add(&state->pending, -1);
+}
+
+
+static void search_state_free(SearchState *state)
+{
+	g_atomic_int_set(&state->cancelled, TRUE);
+	/* tasks can only be queued by running tasks, so wait until they are all done before
+	 * freeing the pool. Cancelled tasks return immediately. */
+	while (g_atomic_int_get(&state->pending) > 0)
+		g_usleep(1000);
+	g_thread_pool_free(state->pool, FALSE, TRUE);
+
+	if (state->flush_source != 0)
+		g_source_remove(state->flush_source);
+
+	g_regex_unref(state->regex);
+	g_regex_unref(state->raw_regex);
+	g_free(state->literal);
+	g_free(state->raw_literal);
+	g_ptr_array_free(state->patterns, TRUE);
+	g_free(state->root);
+	g_hash_table_destroy(state->snapshots);
+	searchindex_unref(state->index);
+	if (state->trigrams != NULL)
+		g_array_free(state->trigrams, TRUE);
+	g_mutex_clear(&state->lock);
+	g_ptr_array_free(state->results, TRUE);
+	g_free(state);
+}
+
+
+static void finish_search(SearchState *state)
+{
+	if (state->n_matches > 0)
+	{
+		gchar *text = ngettext(
+					"Search completed with %d match.",
+					"Search completed with %d matches.", state->n_matches);
+
+		msgwin_msg_add(COLOR_BLUE, -1, NULL, text, (gint) state->n_matches);
+		ui_set_statusbar(FALSE, text, (gint) state->n_matches);
+	}
+	else
+	{
+		const gchar *msg = _("No matches found.");
+
+		msgwin_msg_add_string(COLOR_BLUE, -1, NULL, msg);
+		ui_set_statusbar(FALSE, "%s", msg);
+	}
+	utils_beep();
+	ui_progress_bar_stop();
+}
+
+
+static gboolean flush_results(gpointer data)
+{
+	SearchState *state = data;
+	/* check before taking the results, matches are added before a task is done */
+	gboolean done = g_atomic_int_get(&state->pending) == 0;
+	GPtrArray *results;
+	guint i;
+
+	g_mutex_lock(&state->lock);
+	results = state->results;
+	state->results = g_ptr_array_new_with_free_func(g_free);
+	g_mutex_unlock(&state->lock);
+
+	for (i = 0; i < results->len; i++)
+		msgwin_msg_add_queued(COLOR_BLACK, -1, NULL, results->pdata[i]);
+	g_ptr_array_free(results, TRUE);
+
+	if (! done)
+		return G_SOURCE_CONTINUE;
+
+	state->flush_source = 0;
+	finish_search(state);
+	current_search = NULL;
+	search_state_free(state);
+	return G_SOURCE_REMOVE;
+}
+
+
+static GRegex *compile_search_regex(const gchar *text, const FindInFilesOptions *options,
+		gboolean raw, GError **error)
+{
+	GRegexCompileFlags flags = G_REGEX_MULTILINE | G_REGEX_OPTIMIZE;
+	gchar *pattern;
+	GRegex *regex;
+
+	if (! options->case_sensitive)
+		flags |= G_REGEX_CASELESS;
+	if (raw)
+		flags |= G_REGEX_RAW;
+
+	pattern = options->regexp ? g_strdup(text) : g_regex_escape_string(text, -1);
+	if (options->whole_word)
+		SETPTR(pattern, g_strconcat("(?<!\\w)(?:", pattern, ")(?!\\w)", NULL));
+
+	regex = g_regex_new(pattern, flags, 0, error);
+	g_free(pattern);
+	return regex;
+}
+
+
+/* Starts searching the files in utf8_dir. Returns FALSE if the search couldn't be started. */
+gboolean findinfiles_start(const gchar *utf8_search_text, const gchar *utf8_dir,
+		const FindInFilesOptions *options, const gchar *enc)
+{
+	SearchState *state;
+	GError *error = NULL;
+	gchar *locale_dir, *real_dir, *raw_text = NULL;
+	gchar **pattern;
+	gchar *utf8_str;
+	guint i;
+
+	g_return_val_if_fail(utf8_search_text != NULL && utf8_dir != NULL, FALSE);
+
+	findinfiles_cancel();
+
+	locale_dir = utils_get_locale_from_utf8(utf8_dir);
+	real_dir = tm_get_real_path(locale_dir);
+	if (real_dir == NULL || ! g_file_test(real_dir, G_FILE_TEST_IS_DIR))
+	{
+		ui_set_statusbar(TRUE, _("Could not open directory (%s)"), utf8_dir);
+		g_free(locale_dir);
+		g_free(real_dir);
+		return FALSE;
+	}
+
+	if (enc != NULL)
+		raw_text = g_convert(utf8_search_text, -1, enc, "UTF-8", NULL, NULL, NULL);
+	if (raw_text == NULL)
+		raw_text = g_strdup(utf8_search_text);
+
+	state = g_new0(SearchState, 1);
+	state->regex = compile_search_regex(utf8_search_text, options, FALSE, &error);
+	if (state->regex != NULL)
+		state->raw_regex = compile_search_regex(raw_text, options, TRUE, &error);
+	if (error != NULL)
+	{
+		ui_set_statusbar(FALSE, _("Bad regex: %s"), error->message);
+		g_error_free(error);
+		if (state->regex != NULL)
+			g_regex_unref(state->regex);
+		g_free(state);
+		g_free(raw_text);
+		g_free(locale_dir);
+		g_free(real_dir);
+		return FALSE;
+	}
+
+	/* the index has the file contents as they are on disk */
+	state->index = searchindex_get(real_dir);
+	if (state->index != NULL && ! options->regexp && ! options->invert)
+		state->trigrams = searchindex_get_trigrams(raw_text, options->case_sensitive);
+
+	/* plain text needs to be present as is for a match */
+	if (! options->regexp && options->case_sensitive && ! options->invert)
+	{
+		state->literal = g_strdup(utf8_search_text);
+		state->raw_literal = raw_text;
+	}
+	else
+		g_free(raw_text);
+
+	state->enc = enc;
+	state->invert = options->invert;
+	state->recursive = options->recursive;
+	state->patterns = g_ptr_array_new_with_free_func((GDestroyNotify) g_pattern_spec_free);
+	foreach_strv(pattern, options->patterns)
+	{
+		if (**pattern != '\0')
+			g_ptr_array_add(state->patterns, g_pattern_spec_new(*pattern));
+	}
+	state->root = g_str_has_suffix(real_dir, G_DIR_SEPARATOR_S) ? g_strdup(real_dir) :
+		g_strconcat(real_dir, G_DIR_SEPARATOR_S, NULL);
+	state->root_len = strlen(state->root);
+	g_mutex_init(&state->lock);
+	state->results = g_ptr_array_new_with_free_func(g_free);
+
+	/* search what's being edited rather than the last saved version */
+	state->snapshots = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+
+		if (doc->changed && doc->real_path != NULL)
+		{
+			g_hash_table_insert(state->snapshots, g_strdup(doc->real_path),
+				sci_get_contents(doc->editor->sci, -1));
+		}
+	}
+
+	state->pool = g_thread_pool_new(run_task, state, utils_get_num_processors(), FALSE, NULL);
+	push_task(state, real_dir, TRUE, NULL, NULL);
+	state->flush_source = g_timeout_add(FLUSH_INTERVAL, flush_results, state);
+	current_search = state;
+
+	msgwin_clear_tab(MSG_MESSAGE);
+	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_MESSAGE);
+	ui_progress_bar_start(_("Searching..."));
+	msgwin_set_messages_dir(locale_dir);
+	utf8_str = g_strdup_printf(_("Searching for \"%s\" (in directory: %s)"),
+		utf8_search_text, utf8_dir);
+	msgwin_msg_add_string(COLOR_BLUE, -1, NULL, utf8_str);
+	g_free(utf8_str);
+	g_free(locale_dir);
+
+	return TRUE;
+}
+
+
+/* Stops the running search, if any */
+void findinfiles_cancel(void)
+{
+	if (current_search != NULL)
+	{
+		search_state_free(current_search);
+		current_search = NULL;
+		ui_progress_bar_stop();
+	}
+}
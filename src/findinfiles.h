@@ -0,0 +1,47 @@
+/*
+ *      findinfiles.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GEANY_FINDINFILES_H
+#define GEANY_FINDINFILES_H 1
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct FindInFilesOptions
+{
+	gboolean	regexp;
+	gboolean	case_sensitive;
+	gboolean	whole_word;
+	gboolean	invert;
+	gboolean	recursive;
+	gchar		**patterns;		/* file name patterns to include, NULL for all files */
+}
+FindInFilesOptions;
+
+
+gboolean findinfiles_start(const gchar *utf8_search_text, const gchar *utf8_dir,
+		const FindInFilesOptions *options, const gchar *enc);
+
+void findinfiles_cancel(void);
+
+G_END_DECLS
+
+#endif /* GEANY_FINDINFILES_H */
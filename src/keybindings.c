@@ -1932,7 +1932,7 @@ static void goto_matching_brace(GeanyDocument *doc)
 	pos = sci_get_current_position(sci);
 	after_brace = pos > 0 && utils_isbrace(sci_get_char_at(sci, pos - 1), TRUE);
 	pos -= after_brace;	/* set pos to the brace */
-	new_pos = sci_find_matching_brace(sci, pos);
+	new_pos = editor_find_matching_brace(doc->editor, pos);
 
 	if (new_pos != -1)
 	{	/* set the cursor at/after the brace */
@@ -245,12 +245,32 @@ static void init_pref_groups(void)
 		"use_gtk_word_boundaries", TRUE);
 	stash_group_add_boolean(group, &editor_prefs.complete_snippets_whilst_editing,
 		"complete_snippets_whilst_editing", FALSE);
+	stash_group_add_boolean(group, &editor_prefs.complete_other_doc_words,
+		"complete_other_doc_words", FALSE);
+	stash_group_add_integer(group, &editor_prefs.idle_styling,
+		"idle_styling", SC_IDLESTYLING_NONE);
+	stash_group_add_integer(group, &editor_prefs.layout_cache,
+		"layout_cache", SC_CACHE_CARET);
+	stash_group_add_integer(group, &editor_prefs.layout_threads,
+		"layout_threads", 1);
 	stash_group_add_boolean(group, &file_prefs.use_safe_file_saving,
 		atomic_file_saving_key, FALSE);
 	stash_group_add_boolean(group, &file_prefs.gio_unsafe_save_backup,
 		"gio_unsafe_save_backup", FALSE);
 	stash_group_add_boolean(group, &file_prefs.use_gio_unsafe_file_saving,
 		"use_gio_unsafe_file_saving", TRUE);
+	stash_group_add_boolean(group, &file_prefs.use_async_file_saving,
+		"use_async_file_saving", FALSE);
+	stash_group_add_boolean(group, &file_prefs.use_directory_monitoring,
+		"use_directory_monitoring", TRUE);
+	stash_group_add_integer(group, &file_prefs.large_file_threshold,
+		"large_file_threshold", 64);
+	stash_group_add_integer(group, &file_prefs.large_file_line_length,
+		"large_file_line_length", 256);
+	stash_group_add_integer(group, &file_prefs.undo_memory_limit,
+		"undo_memory_limit", 256);
+	stash_group_add_integer(group, &file_prefs.undo_memory_global_limit,
+		"undo_memory_global_limit", 1024);
 	stash_group_add_boolean(group, &file_prefs.keep_edit_history_on_reload,
 		"keep_edit_history_on_reload", TRUE);
 	stash_group_add_boolean(group, &file_prefs.show_keep_edit_history_on_reload_msg,
@@ -260,6 +280,10 @@ static void init_pref_groups(void)
 		"indent_hard_tab_width", 8);
 	stash_group_add_integer(group, (gint*)&search_prefs.find_selection_type,
 		"find_selection_type", GEANY_FIND_SEL_CURRENT_WORD);
+	stash_group_add_boolean(group, &search_prefs.use_builtin_find_in_files,
+		"use_builtin_find_in_files", TRUE);
+	stash_group_add_boolean(group, &search_prefs.use_find_in_files_index,
+		"use_find_in_files_index", FALSE);
 	stash_group_add_string(group, &file_prefs.extract_filetype_regex,
 		"extract_filetype_regex", GEANY_DEFAULT_FILETYPE_REGEX);
 	stash_group_add_boolean(group, &search_prefs.replace_and_find_by_default,
@@ -132,6 +132,7 @@ gboolean new_instance_mode_arg_callback(const gchar *option_name, const gchar *v
 /* in alphabetical order of short options */
 static GOptionEntry entries[] =
 {
+	{ "benchmark-painting", 0, 0, G_OPTION_ARG_NONE, &cl_options.benchmark_painting, N_("Measure the time of painting documents with each styling and layout setting"), NULL },
 	{ "column", 0, 0, G_OPTION_ARG_INT, &cl_options.goto_column, N_("Set initial column number for the first opened file (useful in conjunction with --line)"), NULL },
 	{ "config", 'c', 0, G_OPTION_ARG_FILENAME, &alternate_config, N_("Use an alternate configuration directory"), NULL },
 	{ "ft-names", 0, 0, G_OPTION_ARG_NONE, &ft_names, N_("Print internal filetype names"), NULL },
@@ -42,26 +42,49 @@
 
 static GString *log_buffer = NULL;
 static GtkTextBuffer *dialog_textbuffer = NULL;
+/* messages can also come from worker threads, so log_buffer is locked and the dialog
+ * is only updated from the thread which set up the handlers */
+static GThread *main_thread = NULL;
+static gint dialog_update_queued = 0;
+G_LOCK_DEFINE_STATIC(log_buffer);
 
 enum
 {
 	DIALOG_RESPONSE_CLEAR = 1
 };
 
+static gboolean update_dialog_idle(gpointer data);
+
 static void update_dialog(void)
 {
+	if (g_thread_self() != main_thread)
+	{
+		if (g_atomic_int_compare_and_exchange(&dialog_update_queued, 0, 1))
+			g_idle_add(update_dialog_idle, NULL);
+		return;
+	}
+
 	if (dialog_textbuffer != NULL)
 	{
 		GtkTextMark *mark;
 		GtkTextView *textview = g_object_get_data(G_OBJECT(dialog_textbuffer), "textview");
 
+		G_LOCK(log_buffer);
 		gtk_text_buffer_set_text(dialog_textbuffer, log_buffer->str, log_buffer->len);
+		G_UNLOCK(log_buffer);
 		/* scroll to the end of the messages as this might be most interesting */
 		mark = gtk_text_buffer_get_insert(dialog_textbuffer);
 		gtk_text_view_scroll_to_mark(textview, mark, 0.0, FALSE, 0.0, 0.0);
 	}
 }
 
+static gboolean update_dialog_idle(G_GNUC_UNUSED gpointer data)
+{
+	g_atomic_int_set(&dialog_update_queued, 0);
+	update_dialog();
+	return G_SOURCE_REMOVE;
+}
+
 /* Geany's main debug/log function, declared in geany.h */
 void geany_debug(gchar const *format, ...)
 {
@@ -76,7 +99,9 @@ static void handler_print(const gchar *msg)
 	printf("%s\n", msg);
 	if (G_LIKELY(log_buffer != NULL))
 	{
+		G_LOCK(log_buffer);
 		g_string_append_printf(log_buffer, "%s\n", msg);
+		G_UNLOCK(log_buffer);
 		update_dialog();
 	}
 }
@@ -86,7 +111,9 @@ static void handler_printerr(const gchar *msg)
 	fprintf(stderr, "%s\n", msg);
 	if (G_LIKELY(log_buffer != NULL))
 	{
+		G_LOCK(log_buffer);
 		g_string_append_printf(log_buffer, "%s\n", msg);
+		G_UNLOCK(log_buffer);
 		update_dialog();
 	}
 }
@@ -134,8 +161,10 @@ static void handler_log(const gchar *domain, GLogLevelFlags level, const gchar *
 
 	time_str = utils_get_current_time_string();
 
+	G_LOCK(log_buffer);
 	g_string_append_printf(log_buffer, "%s: %s %s: %s\n", time_str, domain,
 		get_log_prefix(level), msg);
+	G_UNLOCK(log_buffer);
 
 	g_free(time_str);
 
@@ -145,6 +174,7 @@ static void handler_log(const gchar *domain, GLogLevelFlags level, const gchar *
 void log_handlers_init(void)
 {
 	log_buffer = g_string_sized_new(2048);
+	main_thread = g_thread_self();
 
 	g_set_print_handler(handler_print);
 	g_set_printerr_handler(handler_printerr);
@@ -161,7 +191,9 @@ static void on_dialog_response(GtkDialog *dialog, gint response, gpointer user_d
 		gtk_text_buffer_get_end_iter(dialog_textbuffer, &end_iter);
 		gtk_text_buffer_delete(dialog_textbuffer, &start_iter, &end_iter);
 
+		G_LOCK(log_buffer);
 		g_string_erase(log_buffer, 0, -1);
+		G_UNLOCK(log_buffer);
 	}
 	else
 	{
@@ -53,6 +53,7 @@ typedef struct
 	gboolean 	readonly;
 	gboolean	no_projects;
 	gboolean	favorite;
+	gboolean	benchmark_painting;
 }
 CommandLineOptions;
 
@@ -0,0 +1,351 @@
+/*
+ *      msglist.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * An append-only list model for the message window lists.
+ *
+ * Unlike a GtkListStore, which keeps a GValue per column and a separate string copy for every
+ * row, the strings are packed into large chunks and a row only holds a pointer to its string,
+ * the line, the document ID and a colour index. Clearing just frees the chunks.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "msglist.h"
+
+#include <string.h>
+
+
+/* strings longer than a quarter of this get their own chunk */
+#define CHUNK_SIZE (64 * 1024)
+
+typedef struct
+{
+	const gchar	*string;
+	gint		 line;
+	guint		 doc_id : 28;
+	guint		 color : 4;
+}
+MsgListRow;
+
+struct _GeanyMsgList
+{
+	GObject parent;
+
+	GArray		*rows;			/* MsgListRow */
+	GPtrArray	*chunks;		/* string chunks, the last one is filled */
+	gsize		 chunk_used;	/* bytes used in the last chunk */
+	gint		 stamp;			/* changes when the iterators become invalid */
+	GeanyMsgListColorFunc color_func;
+};
+
+struct _GeanyMsgListClass
+{
+	GObjectClass parent_class;
+};
+
+static void geany_msg_list_tree_model_init(GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(GeanyMsgList, geany_msg_list, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, geany_msg_list_tree_model_init))
+
+
+static void geany_msg_list_finalize(GObject *object)
+{
+	GeanyMsgList *list = GEANY_MSG_LIST(object);
+
+	g_array_free(list->rows, TRUE);
+	g_ptr_array_free(list->chunks, TRUE);
+
+	G_OBJECT_CLASS(geany_msg_list_parent_class)->finalize(object);
+}
+
+
+static void geany_msg_list_class_init(GeanyMsgListClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+	object_class->finalize = geany_msg_list_finalize;
+}
+
+
+static void geany_msg_list_init(GeanyMsgList *list)
+{
+	list->rows = g_array_new(FALSE, FALSE, sizeof(MsgListRow));
+	list->chunks = g_ptr_array_new_with_free_func(g_free);
+	list->chunk_used = CHUNK_SIZE;
+	list->stamp = g_random_int();
+}
+
+
+static inline MsgListRow *get_row(GeanyMsgList *list, GtkTreeIter *iter)
+{
+	g_return_val_if_fail(iter->stamp == list->stamp, NULL);
+
+	return &g_array_index(list->rows, MsgListRow, GPOINTER_TO_UINT(iter->user_data));
+}
+
+
+static inline gboolean set_iter(GeanyMsgList *list, GtkTreeIter *iter, guint index)
+{
+	if (index >= list->rows->len)
+		return FALSE;
+
+	iter->stamp = list->stamp;
+	iter->user_data = GUINT_TO_POINTER(index);
+	return TRUE;
+}
+
+
+static GtkTreeModelFlags msg_list_get_flags(GtkTreeModel *model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+
+static gint msg_list_get_n_columns(GtkTreeModel *model)
+{
+	return GEANY_MSG_LIST_N_COLUMNS;
+}
+
+
+static GType msg_list_get_column_type(GtkTreeModel *model, gint column)
+{
+	switch (column)
+	{
+		case GEANY_MSG_LIST_COL_LINE: return G_TYPE_INT;
+		case GEANY_MSG_LIST_COL_DOC_ID: return G_TYPE_UINT;
+		case GEANY_MSG_LIST_COL_COLOR: return GDK_TYPE_COLOR;
+		case GEANY_MSG_LIST_COL_STRING: return G_TYPE_STRING;
+	}
+	g_return_val_if_reached(G_TYPE_INVALID);
+}
+
+
+static gboolean msg_list_get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	g_return_val_if_fail(gtk_tree_path_get_depth(path) > 0, FALSE);
+
+	if (gtk_tree_path_get_depth(path) != 1)
+		return FALSE;
+	return set_iter(GEANY_MSG_LIST(model), iter, gtk_tree_path_get_indices(path)[0]);
+}
+
+
+static GtkTreePath *msg_list_get_path(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	g_return_val_if_fail(iter->stamp == GEANY_MSG_LIST(model)->stamp, NULL);
+
+	return gtk_tree_path_new_from_indices(GPOINTER_TO_UINT(iter->user_data), -1);
+}
+
+
+static void msg_list_get_value(GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value)
+{
+	GeanyMsgList *list = GEANY_MSG_LIST(model);
+	MsgListRow *row = get_row(list, iter);
+
+	g_return_if_fail(row != NULL);
+
+	g_value_init(value, msg_list_get_column_type(model, column));
+	switch (column)
+	{
+		case GEANY_MSG_LIST_COL_LINE:
+			g_value_set_int(value, row->line);
+			break;
+		case GEANY_MSG_LIST_COL_DOC_ID:
+			g_value_set_uint(value, row->doc_id);
+			break;
+		case GEANY_MSG_LIST_COL_COLOR:
+			g_value_set_static_boxed(value, list->color_func ? list->color_func(row->color) : NULL);
+			break;
+		case GEANY_MSG_LIST_COL_STRING:
+			g_value_set_static_string(value, row->string);
+			break;
+	}
+}
+
+
+static gboolean msg_list_iter_next(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return set_iter(GEANY_MSG_LIST(model), iter, GPOINTER_TO_UINT(iter->user_data) + 1);
+}
+
+
+#if GTK_CHECK_VERSION(3, 0, 0)
+static gboolean msg_list_iter_previous(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	guint index = GPOINTER_TO_UINT(iter->user_data);
+
+	return index > 0 && set_iter(GEANY_MSG_LIST(model), iter, index - 1);
+}
+#endif
+
+
+static gboolean msg_list_iter_nth_child(GtkTreeModel *model, GtkTreeIter *iter,
+		GtkTreeIter *parent, gint n)
+{
+	if (parent != NULL || n < 0)
+		return FALSE;
+	return set_iter(GEANY_MSG_LIST(model), iter, n);
+}
+
+
+static gboolean msg_list_iter_children(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return msg_list_iter_nth_child(model, iter, parent, 0);
+}
+
+
+static gboolean msg_list_iter_has_child(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return FALSE;
+}
+
+
+static gint msg_list_iter_n_children(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return iter == NULL ? (gint) GEANY_MSG_LIST(model)->rows->len : 0;
+}
+
+
+static gboolean msg_list_iter_parent(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	return FALSE;
+}
+
+
+static void geany_msg_list_tree_model_init(GtkTreeModelIface *iface)
+{
+	iface->get_flags = msg_list_get_flags;
+	iface->get_n_columns = msg_list_get_n_columns;
+	iface->get_column_type = msg_list_get_column_type;
+	iface->get_iter = msg_list_get_iter;
+	iface->get_path = msg_list_get_path;
+	iface->get_value = msg_list_get_value;
+	iface->iter_next = msg_list_iter_next;
+#if GTK_CHECK_VERSION(3, 0, 0)
+	iface->iter_previous = msg_list_iter_previous;
+#endif
+	iface->iter_children = msg_list_iter_children;
+	iface->iter_has_child = msg_list_iter_has_child;
+	iface->iter_n_children = msg_list_iter_n_children;
+	iface->iter_nth_child = msg_list_iter_nth_child;
+	iface->iter_parent = msg_list_iter_parent;
+}
+
+
+/* Copies string into the chunks */
+static const gchar *store_string(GeanyMsgList *list, const gchar *string)
+{
+	gsize size = strlen(string) + 1;
+	gchar *chunk;
+
+	if (size > CHUNK_SIZE / 4)
+	{
+		/* keep the last chunk for the following strings */
+		chunk = g_strdup(string);
+		g_ptr_array_add(list->chunks, chunk);
+		if (list->chunks->len > 1)
+		{
+			list->chunks->pdata[list->chunks->len - 1] = list->chunks->pdata[list->chunks->len - 2];
+			list->chunks->pdata[list->chunks->len - 2] = chunk;
+		}
+		else
+			list->chunk_used = CHUNK_SIZE;
+		return chunk;
+	}
+
+	if (list->chunk_used + size > CHUNK_SIZE)
+	{
+		g_ptr_array_add(list->chunks, g_malloc(CHUNK_SIZE));
+		list->chunk_used = 0;
+	}
+	chunk = list->chunks->pdata[list->chunks->len - 1];
+	memcpy(chunk + list->chunk_used, string, size);
+	list->chunk_used += size;
+	return chunk + list->chunk_used - size;
+}
+
+
+GeanyMsgList *geany_msg_list_new(GeanyMsgListColorFunc color_func)
+{
+	GeanyMsgList *list = g_object_new(GEANY_MSG_LIST_TYPE, NULL);
+
+	list->color_func = color_func;
+	return list;
+}
+
+
+/* Appends a row, string must be valid UTF-8 */
+void geany_msg_list_append(GeanyMsgList *list, gint msg_color, gint line, guint doc_id,
+		const gchar *string)
+{
+	MsgListRow row;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	g_return_if_fail(IS_GEANY_MSG_LIST(list));
+	g_return_if_fail(string != NULL);
+
+	row.string = store_string(list, string);
+	row.line = line;
+	row.doc_id = doc_id;
+	row.color = msg_color;
+	g_array_append_val(list->rows, row);
+
+	set_iter(list, &iter, list->rows->len - 1);
+	path = gtk_tree_path_new_from_indices(list->rows->len - 1, -1);
+	gtk_tree_model_row_inserted(GTK_TREE_MODEL(list), path, &iter);
+	gtk_tree_path_free(path);
+}
+
+
+void geany_msg_list_clear(GeanyMsgList *list)
+{
+	GtkTreePath *path;
+	guint i;
+
+	g_return_if_fail(IS_GEANY_MSG_LIST(list));
+
+	/* remove from the end, so the views don't need to move the rows after the removed one */
+	path = gtk_tree_path_new_from_indices(list->rows->len, -1);
+	for (i = list->rows->len; i > 0; i--)
+	{
+		g_array_set_size(list->rows, i - 1);
+		gtk_tree_path_prev(path);
+		gtk_tree_model_row_deleted(GTK_TREE_MODEL(list), path);
+	}
+	gtk_tree_path_free(path);
+
+	g_ptr_array_set_size(list->chunks, 0);
+	list->chunk_used = CHUNK_SIZE;
+	list->stamp++;
+}
+
+
+guint geany_msg_list_get_length(GeanyMsgList *list)
+{
+	g_return_val_if_fail(IS_GEANY_MSG_LIST(list), 0);
+
+	return list->rows->len;
+}
@@ -0,0 +1,63 @@
+/*
+ *      msglist.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GEANY_MSG_LIST_H
+#define GEANY_MSG_LIST_H 1
+
+#include "gtkcompat.h"
+
+G_BEGIN_DECLS
+
+#define GEANY_MSG_LIST_TYPE				(geany_msg_list_get_type())
+#define GEANY_MSG_LIST(obj)				(G_TYPE_CHECK_INSTANCE_CAST((obj), \
+	GEANY_MSG_LIST_TYPE, GeanyMsgList))
+#define GEANY_MSG_LIST_CLASS(klass)		(G_TYPE_CHECK_CLASS_CAST((klass), \
+	GEANY_MSG_LIST_TYPE, GeanyMsgListClass))
+#define IS_GEANY_MSG_LIST(obj)			(G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+	GEANY_MSG_LIST_TYPE))
+#define IS_GEANY_MSG_LIST_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE((klass), \
+	GEANY_MSG_LIST_TYPE))
+
+typedef struct _GeanyMsgList		GeanyMsgList;
+typedef struct _GeanyMsgListClass	GeanyMsgListClass;
+
+/* tree model columns */
+enum
+{
+	GEANY_MSG_LIST_COL_LINE = 0,	/* G_TYPE_INT */
+	GEANY_MSG_LIST_COL_DOC_ID,		/* G_TYPE_UINT */
+	GEANY_MSG_LIST_COL_COLOR,		/* GDK_TYPE_COLOR */
+	GEANY_MSG_LIST_COL_STRING,		/* G_TYPE_STRING */
+	GEANY_MSG_LIST_N_COLUMNS
+};
+
+/* Returns the colour for a #MsgColors value, or NULL for the default colour */
+typedef const GdkColor *(*GeanyMsgListColorFunc)(gint msg_color);
+
+GType			geany_msg_list_get_type		(void);
+GeanyMsgList*	geany_msg_list_new			(GeanyMsgListColorFunc color_func);
+void			geany_msg_list_append		(GeanyMsgList *list, gint msg_color, gint line,
+											 guint doc_id, const gchar *string);
+void			geany_msg_list_clear		(GeanyMsgList *list);
+guint			geany_msg_list_get_length	(GeanyMsgList *list);
+
+G_END_DECLS
+
+#endif /* GEANY_MSG_LIST_H */
@@ -39,6 +39,7 @@
 #include "filetypes.h"
 #include "keybindings.h"
 #include "main.h"
+#include "msglist.h"
 #include "nav.h"
 #include "prefs.h"
 #include "support.h"
@@ -67,20 +68,36 @@ MessageWindow msgwindow;
 
 enum
 {
-	MSG_COL_LINE = 0,
-	MSG_COL_DOC_ID,
-	MSG_COL_COLOR,
-	MSG_COL_STRING,
-	MSG_COL_COUNT
+	MSG_COL_LINE = GEANY_MSG_LIST_COL_LINE,
+	MSG_COL_DOC_ID = GEANY_MSG_LIST_COL_DOC_ID,
+	MSG_COL_COLOR = GEANY_MSG_LIST_COL_COLOR,
+	MSG_COL_STRING = GEANY_MSG_LIST_COL_STRING
 };
 
 enum
 {
-	COMPILER_COL_COLOR = 0,
-	COMPILER_COL_STRING,
-	COMPILER_COL_COUNT
+	COMPILER_COL_COLOR = GEANY_MSG_LIST_COL_COLOR,
+	COMPILER_COL_STRING = GEANY_MSG_LIST_COL_STRING
 };
 
+/* a message line waiting to be added to the Messages tab */
+typedef struct
+{
+	gint		 line;
+	guint		 doc_id;
+	gint		 color;
+	gchar		*string;
+}
+QueuedMsg;
+
+/* QueuedMsg lines, added to msgwindow.store_msg in time slices by flush_msg_queue() */
+static GArray *msg_queue = NULL;
+static guint msg_queue_pos = 0;
+static guint msg_queue_source = 0;
+
+#define MSG_QUEUE_SLICE_USEC 10000
+
+static const GdkColor *get_color(gint msg_color);
 static void prepare_msg_tree_view(void);
 static void prepare_status_tree_view(void);
 static void prepare_compiler_tree_view(void);
@@ -127,8 +144,29 @@ void msgwin_init(void)
 	g_signal_connect(msgwindow.scribble, "populate-popup", G_CALLBACK(on_scribble_populate), NULL);
 }
 
+static void clear_msg_queue(void)
+{
+	guint i;
+
+	if (msg_queue_source != 0)
+	{
+		g_source_remove(msg_queue_source);
+		msg_queue_source = 0;
+	}
+	if (msg_queue == NULL)
+		return;
+
+	for (i = msg_queue_pos; i < msg_queue->len; i++)
+		g_free(g_array_index(msg_queue, QueuedMsg, i).string);
+	g_array_set_size(msg_queue, 0);
+	msg_queue_pos = 0;
+}
+
 void msgwin_finalize(void)
 {
+	clear_msg_queue();
+	if (msg_queue != NULL)
+		g_array_free(msg_queue, TRUE);
 	g_free(msgwindow.messages_dir);
 }
 
@@ -186,8 +224,7 @@ static void prepare_msg_tree_view(void)
 	GtkTreeSelection *selection;
 
 	/* line, doc id, fg, str */
-	msgwindow.store_msg = gtk_list_store_new(MSG_COL_COUNT, G_TYPE_INT, G_TYPE_UINT,
-		GDK_TYPE_COLOR, G_TYPE_STRING);
+	msgwindow.store_msg = geany_msg_list_new(get_color);
 	gtk_tree_view_set_model(GTK_TREE_VIEW(msgwindow.tree_msg), GTK_TREE_MODEL(msgwindow.store_msg));
 	g_object_unref(msgwindow.store_msg);
 
@@ -223,7 +260,7 @@ static void prepare_compiler_tree_view(void)
 	GtkTreeViewColumn *column;
 	GtkTreeSelection *selection;
 
-	msgwindow.store_compiler = gtk_list_store_new(COMPILER_COL_COUNT, GDK_TYPE_COLOR, G_TYPE_STRING);
+	msgwindow.store_compiler = geany_msg_list_new(get_color);
 	gtk_tree_view_set_model(GTK_TREE_VIEW(msgwindow.tree_compiler), GTK_TREE_MODEL(msgwindow.store_compiler));
 	g_object_unref(msgwindow.store_compiler);
 
@@ -290,8 +327,6 @@ void msgwin_compiler_add(gint msg_color, const gchar *format, ...)
 
 void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
 {
-	GtkTreeIter iter;
-	const GdkColor *color = get_color(msg_color);
 	gchar *utf8_msg;
 
 	if (! g_utf8_validate(msg, -1, NULL))
@@ -299,14 +334,12 @@ void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
 	else
 		utf8_msg = (gchar *) msg;
 
-	gtk_list_store_append(msgwindow.store_compiler, &iter);
-	gtk_list_store_set(msgwindow.store_compiler, &iter,
-		COMPILER_COL_COLOR, color, COMPILER_COL_STRING, utf8_msg, -1);
+	geany_msg_list_append(msgwindow.store_compiler, msg_color, -1, 0, utf8_msg);
 
 	if (ui_prefs.msgwindow_visible && interface_prefs.compiler_tab_autoscroll)
 	{
-		GtkTreePath *path = gtk_tree_model_get_path(
-			gtk_tree_view_get_model(GTK_TREE_VIEW(msgwindow.tree_compiler)), &iter);
+		GtkTreePath *path = gtk_tree_path_new_from_indices(
+			geany_msg_list_get_length(msgwindow.store_compiler) - 1, -1);
 
 		gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(msgwindow.tree_compiler), path, NULL, TRUE, 0.5, 0.5);
 		gtk_tree_path_free(path);
@@ -360,40 +393,121 @@ void msgwin_msg_add(gint msg_color, gint line, GeanyDocument *doc, const gchar *
 	g_free(string);
 }
 
-/* adds string to the msg treeview */
-void msgwin_msg_add_string(gint msg_color, gint line, GeanyDocument *doc, const gchar *string)
+/* Returns a copy of string valid for the message lists */
+static gchar *make_msg_string(const gchar *string)
 {
-	GtkTreeIter iter;
-	const GdkColor *color = get_color(msg_color);
 	gchar *tmp;
-	gsize len;
 	gchar *utf8_msg;
 
-	if (! ui_prefs.msgwindow_visible)
-		msgwin_show_hide(TRUE);
-
 	/* work around a strange problem when adding very long lines(greater than 4000 bytes)
 	 * cut the string to a maximum of 1024 bytes and discard the rest */
 	/* TODO: find the real cause for the display problem / if it is GtkTreeView file a bug report */
-	len = strlen(string);
-	if (len > 1024)
-		tmp = g_strndup(string, 1024);
-	else
-		tmp = g_strdup(string);
-
-	if (! g_utf8_validate(tmp, -1, NULL))
-		utf8_msg = utils_get_utf8_from_locale(tmp);
-	else
-		utf8_msg = tmp;
+	tmp = g_strndup(string, 1024);
 
-	gtk_list_store_append(msgwindow.store_msg, &iter);
-	gtk_list_store_set(msgwindow.store_msg, &iter,
-		MSG_COL_LINE, line, MSG_COL_DOC_ID, doc ? doc->id : 0, MSG_COL_COLOR,
-		color, MSG_COL_STRING, utf8_msg, -1);
+	if (g_utf8_validate(tmp, -1, NULL))
+		return tmp;
 
+	utf8_msg = utils_get_utf8_from_locale(tmp);
 	g_free(tmp);
-	if (utf8_msg != tmp)
-		g_free(utf8_msg);
+	return utf8_msg;
+}
+
+static gboolean flush_msg_queue(G_GNUC_UNUSED gpointer data)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(msgwindow.store_msg);
+	gint64 deadline = g_get_monotonic_time() + MSG_QUEUE_SLICE_USEC;
+	gboolean detach;
+
+	/* filling an empty list is much faster when the view doesn't follow each row, and there's
+	 * no scroll position or selection to lose yet */
+	detach = msg_queue->len - msg_queue_pos > 1000 &&
+		gtk_tree_model_iter_n_children(model, NULL) == 0;
+	if (detach)
+	{
+		g_object_ref(model);
+		gtk_tree_view_set_model(GTK_TREE_VIEW(msgwindow.tree_msg), NULL);
+	}
+
+	do
+	{
+		guint n;
+
+		for (n = 0; n < 256 && msg_queue_pos < msg_queue->len; n++, msg_queue_pos++)
+		{
+			QueuedMsg *msg = &g_array_index(msg_queue, QueuedMsg, msg_queue_pos);
+
+			geany_msg_list_append(msgwindow.store_msg, msg->color, msg->line, msg->doc_id,
+				msg->string);
+			g_free(msg->string);
+		}
+	}
+	while (msg_queue_pos < msg_queue->len && g_get_monotonic_time() < deadline);
+
+	if (detach)
+	{
+		gtk_tree_view_set_model(GTK_TREE_VIEW(msgwindow.tree_msg), model);
+		g_object_unref(model);
+	}
+
+	if (msg_queue_pos < msg_queue->len)
+		return G_SOURCE_CONTINUE;
+
+	g_array_set_size(msg_queue, 0);
+	msg_queue_pos = 0;
+	msg_queue_source = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/* Adds string to the msg treeview in batches from an idle callback, which keeps the UI responsive
+ * for many lines. Lines added with msgwin_msg_add_string() meanwhile are queued as well to keep
+ * their order. */
+void msgwin_msg_add_queued(gint msg_color, gint line, GeanyDocument *doc, const gchar *string)
+{
+	QueuedMsg msg;
+
+	if (! ui_prefs.msgwindow_visible)
+		msgwin_show_hide(TRUE);
+
+	if (msg_queue == NULL)
+		msg_queue = g_array_new(FALSE, FALSE, sizeof(QueuedMsg));
+
+	msg.line = line;
+	msg.doc_id = doc ? doc->id : 0;
+	msg.color = msg_color;
+	msg.string = make_msg_string(string);
+	g_array_append_val(msg_queue, msg);
+
+	if (msg_queue_source == 0)
+		msg_queue_source = g_idle_add(flush_msg_queue, NULL);
+}
+
+/* Returns the number of lines in the Messages tab, including queued ones */
+guint msgwin_msg_count(void)
+{
+	guint count = geany_msg_list_get_length(msgwindow.store_msg);
+
+	if (msg_queue != NULL)
+		count += msg_queue->len - msg_queue_pos;
+	return count;
+}
+
+/* adds string to the msg treeview */
+void msgwin_msg_add_string(gint msg_color, gint line, GeanyDocument *doc, const gchar *string)
+{
+	gchar *utf8_msg;
+
+	if (msg_queue_source != 0)
+	{
+		msgwin_msg_add_queued(msg_color, line, doc, string);
+		return;
+	}
+
+	if (! ui_prefs.msgwindow_visible)
+		msgwin_show_hide(TRUE);
+
+	utf8_msg = make_msg_string(string);
+	geany_msg_list_append(msgwindow.store_msg, msg_color, line, doc ? doc->id : 0, utf8_msg);
+	g_free(utf8_msg);
 }
 
 /**
@@ -488,7 +602,7 @@ on_compiler_treeview_copy_activate(GtkMenuItem *menuitem, gpointer user_data)
 
 static void on_compiler_treeview_copy_all_activate(GtkMenuItem *menuitem, gpointer user_data)
 {
-	GtkListStore *store = msgwindow.store_compiler;
+	GtkTreeModel *model = GTK_TREE_MODEL(msgwindow.store_compiler);
 	GtkTreeIter iter;
 	GString *str = g_string_new("");
 	gint str_idx = COMPILER_COL_STRING;
@@ -497,7 +611,7 @@ static void on_compiler_treeview_copy_all_activate(GtkMenuItem *menuitem, gpoint
 	switch (GPOINTER_TO_INT(user_data))
 	{
 		case MSG_STATUS:
-		store = msgwindow.store_status;
+		model = GTK_TREE_MODEL(msgwindow.store_status);
 		str_idx = 0;
 		break;
 
@@ -506,18 +620,18 @@ static void on_compiler_treeview_copy_all_activate(GtkMenuItem *menuitem, gpoint
 		break;
 
 		case MSG_MESSAGE:
-		store = msgwindow.store_msg;
+		model = GTK_TREE_MODEL(msgwindow.store_msg);
 		str_idx = MSG_COL_STRING;
 		break;
 	}
 
 	/* walk through the list and copy every line into a string */
-	valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(store), &iter);
+	valid = gtk_tree_model_get_iter_first(model, &iter);
 	while (valid)
 	{
 		gchar *line = NULL;
 
-		gtk_tree_model_get(GTK_TREE_MODEL(store), &iter, str_idx, &line, -1);
+		gtk_tree_model_get(model, &iter, str_idx, &line, -1);
 		if (!EMPTY(line))
 		{
 			g_string_append(str, line);
@@ -525,7 +639,7 @@ static void on_compiler_treeview_copy_all_activate(GtkMenuItem *menuitem, gpoint
 		}
 		g_free(line);
 
-		valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(store), &iter);
+		valid = gtk_tree_model_iter_next(model, &iter);
 	}
 
 	/* copy the string into the clipboard */
@@ -1204,6 +1318,16 @@ void msgwin_switch_tab(gint tabnum, gboolean show)
 		gtk_widget_grab_focus(widget);
 }
 
+static void clear_msg_list(GtkWidget *tree, GeanyMsgList *list)
+{
+	/* the view drops all its rows at once instead of following every removed row */
+	g_object_ref(list);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(tree), NULL);
+	geany_msg_list_clear(list);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(tree), GTK_TREE_MODEL(list));
+	g_object_unref(list);
+}
+
 /**
  *  Removes all messages from a tab specified by @a tabnum in the messages window.
  *
@@ -1220,11 +1344,12 @@ void msgwin_clear_tab(gint tabnum)
 	switch (tabnum)
 	{
 		case MSG_MESSAGE:
-			store = msgwindow.store_msg;
-			break;
+			clear_msg_queue();
+			clear_msg_list(msgwindow.tree_msg, msgwindow.store_msg);
+			return;
 
 		case MSG_COMPILER:
-			gtk_list_store_clear(msgwindow.store_compiler);
+			clear_msg_list(msgwindow.tree_compiler, msgwindow.store_compiler);
 			build_menu_update(NULL);	/* update next error items */
 			return;
 
@@ -68,8 +68,8 @@ void msgwin_set_messages_dir(const gchar *messages_dir);
 typedef struct
 {
 	GtkListStore	*store_status;
-	GtkListStore	*store_msg;
-	GtkListStore	*store_compiler;
+	struct _GeanyMsgList	*store_msg;
+	struct _GeanyMsgList	*store_compiler;
 	GtkWidget		*tree_compiler;
 	GtkWidget		*tree_status;
 	GtkWidget		*tree_msg;
@@ -91,6 +91,10 @@ void msgwin_show_hide(gboolean show);
 
 void msgwin_msg_add_string(gint msg_color, gint line, GeanyDocument *doc, const gchar *string);
 
+void msgwin_msg_add_queued(gint msg_color, gint line, GeanyDocument *doc, const gchar *string);
+
+guint msgwin_msg_count(void);
+
 void msgwin_compiler_add_string(gint msg_color, const gchar *msg);
 
 void msgwin_show_hide_tabs(void);
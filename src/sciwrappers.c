@@ -1199,3 +1199,89 @@ gint sci_last_line(ScintillaObject *sci)
 	gint len = sci_get_length(sci);
 	return sci_get_line_from_position(sci, len - 1);
 }
+
+/* The returned pointer is only valid until the next modifying call on sci */
+const gchar *sci_get_character_pointer(ScintillaObject *sci)
+{
+	return (const gchar *) SSM(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+}
+
+gint sci_get_undo_current(ScintillaObject *sci)
+{
+	return (gint) SSM(sci, SCI_GETUNDOCURRENT, 0, 0);
+}
+
+void sci_set_undo_save_point(ScintillaObject *sci, gint action)
+{
+	SSM(sci, SCI_SETUNDOSAVEPOINT, (uptr_t) action, 0);
+}
+
+void sci_append_text(ScintillaObject *sci, const gchar *text, gsize len)
+{
+	SSM(sci, SCI_APPENDTEXT, len, (sptr_t) text);
+}
+
+/* Reserves room for bytes of text to avoid reallocating while appending */
+void sci_allocate(ScintillaObject *sci, gsize bytes)
+{
+	SSM(sci, SCI_ALLOCATE, bytes, 0);
+}
+
+gint sci_get_undo_actions(ScintillaObject *sci)
+{
+	return (gint) SSM(sci, SCI_GETUNDOACTIONS, 0, 0);
+}
+
+gint sci_get_undo_save_point(ScintillaObject *sci)
+{
+	return (gint) SSM(sci, SCI_GETUNDOSAVEPOINT, 0, 0);
+}
+
+gint sci_get_undo_detach(ScintillaObject *sci)
+{
+	return (gint) SSM(sci, SCI_GETUNDODETACH, 0, 0);
+}
+
+void sci_set_undo_detach(ScintillaObject *sci, gint action)
+{
+	SSM(sci, SCI_SETUNDODETACH, (uptr_t) action, 0);
+}
+
+gint sci_get_undo_tentative(ScintillaObject *sci)
+{
+	return (gint) SSM(sci, SCI_GETUNDOTENTATIVE, 0, 0);
+}
+
+void sci_set_undo_tentative(ScintillaObject *sci, gint action)
+{
+	SSM(sci, SCI_SETUNDOTENTATIVE, (uptr_t) action, 0);
+}
+
+void sci_set_undo_current(ScintillaObject *sci, gint action)
+{
+	SSM(sci, SCI_SETUNDOCURRENT, (uptr_t) action, 0);
+}
+
+/* Returns the action type, including the coalesce flag */
+gint sci_get_undo_action_type(ScintillaObject *sci, gint action)
+{
+	return (gint) SSM(sci, SCI_GETUNDOACTIONTYPE, (uptr_t) action, 0);
+}
+
+gint sci_get_undo_action_position(ScintillaObject *sci, gint action)
+{
+	return (gint) SSM(sci, SCI_GETUNDOACTIONPOSITION, (uptr_t) action, 0);
+}
+
+/* Copies the action text into text if not NULL, and returns its length */
+gsize sci_get_undo_action_text(ScintillaObject *sci, gint action, gchar *text)
+{
+	return (gsize) SSM(sci, SCI_GETUNDOACTIONTEXT, (uptr_t) action, (sptr_t) text);
+}
+
+void sci_push_undo_action(ScintillaObject *sci, gint type, gint position,
+		const gchar *text, gsize len)
+{
+	SSM(sci, SCI_PUSHUNDOACTIONTYPE, (uptr_t) type, position);
+	SSM(sci, SCI_CHANGELASTUNDOACTIONTEXT, len, (sptr_t) text);
+}
@@ -208,6 +208,24 @@ void				sci_move_selected_lines_up      (ScintillaObject *sci);
 
 gint                sci_last_line               (ScintillaObject *sci);
 
+const gchar*		sci_get_character_pointer	(ScintillaObject *sci);
+gint				sci_get_undo_current		(ScintillaObject *sci);
+void				sci_set_undo_save_point		(ScintillaObject *sci, gint action);
+void				sci_append_text				(ScintillaObject *sci, const gchar *text, gsize len);
+void				sci_allocate				(ScintillaObject *sci, gsize bytes);
+gint				sci_get_undo_actions		(ScintillaObject *sci);
+gint				sci_get_undo_save_point		(ScintillaObject *sci);
+gint				sci_get_undo_detach			(ScintillaObject *sci);
+void				sci_set_undo_detach			(ScintillaObject *sci, gint action);
+gint				sci_get_undo_tentative		(ScintillaObject *sci);
+void				sci_set_undo_tentative		(ScintillaObject *sci, gint action);
+void				sci_set_undo_current		(ScintillaObject *sci, gint action);
+gint				sci_get_undo_action_type	(ScintillaObject *sci, gint action);
+gint				sci_get_undo_action_position	(ScintillaObject *sci, gint action);
+gsize				sci_get_undo_action_text	(ScintillaObject *sci, gint action, gchar *text);
+void				sci_push_undo_action		(ScintillaObject *sci, gint type, gint position,
+												 const gchar *text, gsize len);
+
 #endif /* GEANY_PRIVATE */
 
 G_END_DECLS
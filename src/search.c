@@ -34,10 +34,12 @@
 #include "document.h"
 #include "encodings.h"
 #include "encodingsprivate.h"
+#include "findinfiles.h"
 #include "keyfile.h"
 #include "msgwindow.h"
 #include "prefs.h"
 #include "sciwrappers.h"
+#include "searchindex.h"
 #include "spawn.h"
 #include "stash.h"
 #include "support.h"
@@ -151,6 +153,9 @@ static gchar **search_get_argv(const gchar **argv_prefix, const gchar *dir);
 
 static GRegex *compile_regex(const gchar *str, GeanyFindFlags sflags);
 
+static gint find_match(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_TextToFind *ttf,
+		GRegex *regex, GeanyMatchInfo *match);
+
 static void
 on_find_replace_checkbutton_toggled(GtkToggleButton *togglebutton, gpointer user_data);
 
@@ -172,6 +177,38 @@ on_replace_find_entry_activate(GtkEntry *entry, gpointer user_data);
 static void
 on_replace_entry_activate(GtkEntry *entry, gpointer user_data);
 
+/* The extra options are passed to grep, so they need the external tool */
+static gboolean use_builtin_find_in_files(void)
+{
+	if (! search_prefs.use_builtin_find_in_files)
+		return FALSE;
+
+	g_strstrip(settings.fif_extra_options);
+	return ! settings.fif_use_extra_options || EMPTY(settings.fif_extra_options);
+}
+
+static gboolean find_in_files_builtin(const gchar *search_text, const gchar *utf8_dir,
+		const gchar *enc)
+{
+	FindInFilesOptions options;
+	gboolean ret;
+
+	options.regexp = settings.fif_regexp;
+	options.case_sensitive = settings.fif_case_sensitive;
+	options.whole_word = settings.fif_match_whole_word;
+	options.invert = settings.fif_invert_results;
+	options.recursive = settings.fif_recursive;
+	options.patterns = NULL;
+
+	g_strstrip(settings.fif_files);
+	if (settings.fif_files_mode != FILES_MODE_ALL && *settings.fif_files)
+		options.patterns = g_strsplit(settings.fif_files, " ", -1);
+
+	ret = findinfiles_start(search_text, utf8_dir, &options, enc);
+	g_strfreev(options.patterns);
+	return ret;
+}
+
 static void
 on_find_in_files_dialog_response(GtkDialog *dialog, gint response, gpointer user_data);
 
@@ -269,6 +306,7 @@ void search_init(void)
 	search_data.text = NULL;
 	search_data.original_text = NULL;
 	init_prefs();
+	searchindex_init();
 }
 
 #define FREE_WIDGET(wid) \
@@ -279,6 +317,8 @@ void search_finalize(void)
 	FREE_WIDGET(find_dlg.dialog);
 	FREE_WIDGET(replace_dlg.dialog);
 	FREE_WIDGET(fif_dlg.dialog);
+	findinfiles_cancel();
+	searchindex_finalize();
 	g_free(search_data.text);
 	g_free(search_data.original_text);
 }
@@ -1158,31 +1198,34 @@ void geany_match_info_free(GeanyMatchInfo *info)
 	g_slice_free1(sizeof *info, info);
 }
 
-/* find all in the given range.
- * Returns a list of allocated GeanyMatchInfo, should be freed using:
- *
- * 	foreach_slist(node, matches)
- * 		geany_match_info_free(node->data);
- * 	g_slist_free(matches); */
-static GSList *find_range(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_TextToFind *ttf)
+/* Called for each match, the match is only valid during the call.
+ * Returns FALSE to stop searching. */
+typedef gboolean (*SearchMatchFunc)(GeanyMatchInfo *match, gpointer user_data);
+
+/* Calls func for each match in the given range, reusing the same match info and compiled regex.
+ * Plain text matches are completely in range, regex matches only start in it.
+ * ttf->chrg.cpMin is updated to the position to search the next match at. */
+static void foreach_match(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_TextToFind *ttf,
+		SearchMatchFunc func, gpointer user_data)
 {
-	GSList *matches = NULL;
-	GeanyMatchInfo *info;
+	GeanyMatchInfo match = { 0 };
+	GRegex *regex = NULL;
 
-	g_return_val_if_fail(sci != NULL && ttf->lpstrText != NULL, NULL);
+	g_return_if_fail(sci != NULL && ttf->lpstrText != NULL && func != NULL);
 	if (! *ttf->lpstrText)
-		return NULL;
+		return;
 
-	while (search_find_text(sci, flags, ttf, &info) != -1)
+	if (flags & GEANY_FIND_REGEXP)
 	{
-		if (ttf->chrgText.cpMax > ttf->chrg.cpMax)
-		{
-			/* found text is partially out of range */
-			geany_match_info_free(info);
-			break;
-		}
+		regex = compile_regex(ttf->lpstrText, flags);
+		if (!regex)
+			return;
+	}
+	match.flags = flags;
 
-		matches = g_slist_prepend(matches, info);
+	while (ttf->chrg.cpMin <= ttf->chrg.cpMax &&
+		find_match(sci, flags, ttf, regex, &match) != -1)
+	{
 		ttf->chrg.cpMin = ttf->chrgText.cpMax;
 
 		/* avoid rematching with empty matches like "(?=[a-z])" or "^$".
@@ -1190,46 +1233,85 @@ static GSList *find_range(ScintillaObject *sci, GeanyFindFlags flags, struct Sci
 		 * matches like "a?(?=b)" will sometimes be empty and sometimes not */
 		if (ttf->chrgText.cpMax == ttf->chrgText.cpMin)
 			ttf->chrg.cpMin ++;
+
+		if (! func(&match, user_data))
+			break;
 	}
 
-	return g_slist_reverse(matches);
+	g_free(match.match_text);
+	if (regex)
+		g_regex_unref(regex);
 }
 
-/* Highlights or unhighlights matching texts
+typedef struct
+{
+	ScintillaObject *sci;
+	gboolean clear_mode;
+	gint end;
+	gint resume;
+	gint count;
+}
+HighlightData;
+
+static gboolean highlight_match(GeanyMatchInfo *match, gpointer user_data)
+{
+	HighlightData *data = user_data;
+
+	if (match->start >= data->end)
+		return FALSE;
+
+	if (match->end != match->start)
+		(data->clear_mode ? sci_indicator_clear : sci_indicator_fill)(data->sci, match->start,
+			match->end - match->start);
+	data->count++;
+	data->resume = MAX(data->end, match->end > match->start ? match->end : match->start + 1);
+	return TRUE;
+}
+
+/* Highlights or unhighlights matches starting in the range start..end, filling the indicator
+ * directly without collecting the matches first.
+ * @param resume Return location for the position the next range should start at, as the last
+ * match can extend past @a end, or @c NULL.
  * @return Number of matches marked. */
-gint search_highlight_all(ScintillaObject *sci, const gchar *search_text, GeanyFindFlags flags,
-		gint indicator, gboolean clear_mode)
+gint search_highlight_range(ScintillaObject *sci, const gchar *search_text, GeanyFindFlags flags,
+		gint indicator, gboolean clear_mode, gint start, gint end, gint *resume)
 {
+	struct Sci_TextToFind ttf;
+	HighlightData data = { sci, clear_mode, end, end, 0 };
+
 	g_return_val_if_fail(sci != NULL, 0);
 
-	if (G_UNLIKELY(EMPTY(search_text)))
+	if (resume)
+		*resume = end;
+	if (G_UNLIKELY(EMPTY(search_text)) || start >= end)
 		return 0;
 
-	struct Sci_TextToFind ttf;
-	ttf.chrg.cpMin = 0;
-	ttf.chrg.cpMax = sci_get_length(sci);
+	ttf.chrg.cpMin = start;
+	/* regex matches are only checked for their start position, plain text ones must be
+	 * completely in range, so allow them to end after the range */
+	if (flags & GEANY_FIND_REGEXP)
+		ttf.chrg.cpMax = end;
+	else
+		ttf.chrg.cpMax = MIN(end + (gint) strlen(search_text) - 1, sci_get_length(sci));
 	ttf.lpstrText = (gchar *)search_text;
 
-	GSList *matches = find_range(sci, flags, &ttf);
-	GSList *match;
-	gint count = 0;
-
 	sci_indicator_set(sci, indicator);
+	foreach_match(sci, flags, &ttf, highlight_match, &data);
 
-	foreach_slist (match, matches)
-	{
-		GeanyMatchInfo *info = match->data;
-		gint start = info->start, end = info->end;
-
-		if (end != start)
-			(clear_mode ? sci_indicator_clear : sci_indicator_fill)(sci, start, end - start);
+	if (resume)
+		*resume = data.resume;
+	return data.count;
+}
 
-		geany_match_info_free(info);
-		count++;
-	}
+/* Highlights or unhighlights matching texts
+ * @return Number of matches marked. */
+gint search_highlight_all(ScintillaObject *sci, const gchar *search_text, GeanyFindFlags flags,
+		gint indicator, gboolean clear_mode)
+{
+	g_return_val_if_fail(sci != NULL, 0);
 
-	g_slist_free(matches);
-	return count;
+	return search_highlight_range(sci, search_text, flags, indicator, clear_mode,
+		0, sci_get_length(sci), NULL);
 }
 
 static void
@@ -1366,18 +1448,196 @@ on_replace_entry_activate(GtkEntry *entry, gpointer user_data)
 		NULL);
 }
 
+typedef struct
+{
+	GeanyDocument *doc;
+	const gchar *text;
+	gint length;
+	gboolean found;
+	GArray *matches;	/* start positions of all matches, or NULL for the Scintilla search */
+}
+SessionSearchItem;
+
+typedef struct
+{
+	GRegex *regex;
+	gboolean collect;		/* whether the regex matches exactly like the Scintilla search */
+	gboolean skip_crlf;		/* whether empty matches between CR and LF are skipped */
+}
+SessionSearch;
+
+/* Collects the matches like foreach_match() does for the whole document */
+static void session_search_collect(SessionSearch *search, SessionSearchItem *item,
+		GError **error)
+{
+	gint pos = 0;
+
+	item->matches = g_array_new(FALSE, FALSE, sizeof(gint));
+	/* find_regex() skips empty documents */
+	while (item->length > 0 && pos <= item->length)
+	{
+		GMatchInfo *minfo;
+		gint start, end;
+
+		if (! g_regex_match_full(search->regex, item->text, item->length, pos, 0, &minfo,
+				error) || ! g_match_info_fetch_pos(minfo, 0, &start, &end))
+		{
+			g_match_info_free(minfo);
+			break;
+		}
+		g_match_info_free(minfo);
+
+		/* see find_regex() */
+		if (search->skip_crlf && start > 0 && item->text[start - 1] == '\r' &&
+			item->text[start] == '\n')
+		{
+			pos = start + 1;
+			continue;
+		}
+		g_array_append_val(item->matches, start);
+		pos = (end == start) ? end + 1 : end;
+	}
+}
+
+static void session_search_document(gpointer data, gpointer user_data)
+{
+	SessionSearchItem *item = data;
+	SessionSearch *search = user_data;
+	GError *error = NULL;
+
+	if (search->collect)
+	{
+		session_search_collect(search, item, &error);
+		item->found = item->matches->len > 0;
+	}
+	else
+		item->found = g_regex_match_full(search->regex, item->text, item->length, 0, 0, NULL, &error);
+
+	/* e.g. invalid UTF-8, which the Scintilla search still handles */
+	if (error != NULL)
+	{
+		g_error_free(error);
+		if (item->matches != NULL)
+		{
+			g_array_free(item->matches, TRUE);
+			item->matches = NULL;
+		}
+		item->found = TRUE;
+	}
+}
+
+static void session_search_items_free(GArray *items)
+{
+	guint i;
+
+	for (i = 0; i < items->len; i++)
+	{
+		SessionSearchItem *item = &g_array_index(items, SessionSearchItem, i);
+
+		if (item->matches != NULL)
+			g_array_free(item->matches, TRUE);
+	}
+	g_array_free(items, TRUE);
+}
+
+/* Searches the open documents in parallel and returns the ones which might contain matches,
+ * in tab order. The result is exact for regexes run over the whole buffer and otherwise a
+ * superset, so the Scintilla search is still done on the result. If collect_matches is set,
+ * the matches are also collected where they are exactly what the Scintilla search would find.
+ * The main thread waits for the search, so the buffers can't change meanwhile. */
+static GArray *search_session_documents(const gchar *search_text, GeanyFindFlags flags,
+		gboolean collect_matches)
+{
+	GArray *items = g_array_new(FALSE, TRUE, sizeof(SessionSearchItem));
+	SessionSearch search = { NULL, FALSE, FALSE };
+	GeanyDocument *doc;
+	GThreadPool *pool;
+	guint i, n;
+
+	foreach_ordered_document(doc)
+	{
+		SessionSearchItem item = { doc, NULL, 0, TRUE, NULL };
+
+		g_array_append_val(items, item);
+	}
+	if (items->len < 2 && ! collect_matches)
+		return items;
+
+	if (flags & GEANY_FIND_REGEXP)
+	{
+		search.regex = compile_regex(search_text, flags);
+		if (search.regex == NULL)
+		{
+			g_array_set_size(items, 0);
+			return items;
+		}
+		/* single-line mode regexes that aren't run over the whole buffer might match differently */
+		if (! (g_regex_get_compile_flags(search.regex) & G_REGEX_MULTILINE))
+		{
+			g_regex_unref(search.regex);
+			return items;
+		}
+		search.collect = collect_matches;
+		search.skip_crlf = ! (flags & GEANY_FIND_MULTILINE);
+	}
+	else
+	{
+		gchar *pattern = g_regex_escape_string(search_text, -1);
+
+		/* whole word and word start flags are checked by the Scintilla search */
+		search.regex = g_regex_new(pattern, G_REGEX_OPTIMIZE |
+			((flags & GEANY_FIND_MATCHCASE) ? 0 : G_REGEX_CASELESS), 0, NULL);
+		g_free(pattern);
+		if (search.regex == NULL)
+			return items;
+		/* caseless matching may differ from Scintilla's for some characters */
+		search.collect = collect_matches && (flags & GEANY_FIND_MATCHCASE) &&
+			! (flags & (GEANY_FIND_WHOLEWORD | GEANY_FIND_WORDSTART));
+	}
+
+	for (i = 0; i < items->len; i++)
+	{
+		SessionSearchItem *item = &g_array_index(items, SessionSearchItem, i);
+		ScintillaObject *sci = item->doc->editor->sci;
+
+		item->length = sci_get_length(sci);
+		item->text = sci_get_character_pointer(sci);
+	}
+
+	pool = g_thread_pool_new(session_search_document, &search, utils_get_num_processors(), FALSE, NULL);
+	for (i = 0; i < items->len; i++)
+		g_thread_pool_push(pool, &g_array_index(items, SessionSearchItem, i), NULL);
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	/* keep the documents which might contain matches */
+	for (i = 0, n = 0; i < items->len; i++)
+	{
+		SessionSearchItem *item = &g_array_index(items, SessionSearchItem, i);
+
+		if (item->found)
+			g_array_index(items, SessionSearchItem, n++) = *item;
+		else if (item->matches != NULL)
+			g_array_free(item->matches, TRUE);
+	}
+	g_array_set_size(items, n);
+	g_regex_unref(search.regex);
+	return items;
+}
+
 static void replace_in_session(GeanyDocument *doc, GeanyFindFlags search_flags_re,
 		gboolean search_replace_escape_re, const gchar *find, const gchar *replace,
 		const gchar *original_find, const gchar *original_replace)
 {
-	GeanyDocument *tmp_doc;
+	GArray *items;
 	gint rep_count = 0, file_count = 0, reps;
+	guint i;
 
 	/* replace in all documents following notebook tab order */
-	foreach_ordered_document(tmp_doc)
+	items = search_session_documents(find, search_flags_re, FALSE);
+	for (i = 0; i < items->len; i++)
 	{
-		reps = document_replace_all(tmp_doc, find, replace, original_find, original_replace,
-				search_flags_re);
+		reps = document_replace_all(g_array_index(items, SessionSearchItem, i).doc, find, replace,
+				original_find, original_replace, search_flags_re);
 
 		if (reps)
 		{
@@ -1385,6 +1645,7 @@ static void replace_in_session(GeanyDocument *doc, GeanyFindFlags search_flags_r
 			file_count++;
 		}
 	}
+	session_search_items_free(items);
 
 	if (file_count == 0)
 	{
@@ -1588,18 +1849,26 @@ on_find_in_files_dialog_response(GtkDialog *dialog, gint response,
 			ui_set_statusbar(FALSE, _("Invalid directory for find in files."));
 		else if (!EMPTY(search_text))
 		{
-			GString *opts = get_grep_options();
 			const gchar *enc = (enc_idx == GEANY_ENCODING_UTF_8) ? NULL :
 				encodings_get_charset_from_index(enc_idx);
+			gboolean started;
 
-			if (search_find_in_files(search_text, utf8_dir, opts->str, enc))
+			if (use_builtin_find_in_files())
+				started = find_in_files_builtin(search_text, utf8_dir, enc);
+			else
+			{
+				GString *opts = get_grep_options();
+
+				started = search_find_in_files(search_text, utf8_dir, opts->str, enc);
+				g_string_free(opts, TRUE);
+			}
+			if (started)
 			{
 				ui_combo_box_add_to_history(GTK_COMBO_BOX_TEXT(search_combo), search_text, 0);
 				ui_combo_box_add_to_history(GTK_COMBO_BOX_TEXT(fif_dlg.files_combo), NULL, 0);
 				ui_combo_box_add_to_history(GTK_COMBO_BOX_TEXT(dir_combo), utf8_dir, 0);
 				gtk_widget_hide(fif_dlg.dialog);
 			}
-			g_string_free(opts, TRUE);
 		}
 		else
 			ui_set_statusbar(FALSE, _("No text to find."));
@@ -1666,7 +1935,7 @@ search_find_in_files(const gchar *utf8_search_text, const gchar *utf8_dir, const
 		}
 	}
 
-	gtk_list_store_clear(msgwindow.store_msg);
+	msgwin_clear_tab(MSG_MESSAGE);
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_MESSAGE);
 
 	/* we can pass 'enc' without strdup'ing it here because it's a global const string and
@@ -1792,7 +2061,7 @@ static void read_fif_io(gchar *msg, GIOCondition condition, gchar *enc, gint msg
 		else
 			utf8_msg = msg;
 
-		msgwin_msg_add_string(msg_color, -1, NULL, utf8_msg);
+		msgwin_msg_add_queued(msg_color, -1, NULL, utf8_msg);
 
 		if (utf8_msg != msg)
 			g_free(utf8_msg);
@@ -1832,8 +2101,7 @@ static void search_finished(GPid child_pid, gint status, gpointer user_data)
 	{
 		case 0:
 		{
-			gint count = gtk_tree_model_iter_n_children(
-				GTK_TREE_MODEL(msgwindow.store_msg), NULL) - 1;
+			gint count = (gint) msgwin_msg_count() - 1;
 			gchar *text = ngettext(
 						"Search completed with %d match.",
 						"Search completed with %d matches.", count);
@@ -1853,6 +2121,48 @@ static void search_finished(GPid child_pid, gint status, gpointer user_data)
 	ui_progress_bar_stop();
 }
 
+/* Checks whether a single-line mode pattern can only match text inside a line, so that it can be
+ * run once over the whole buffer with line anchored ^ and $ instead of line by line, with the
+ * same results. This is conservative: anything that could match a line break or check the
+ * start or end of the subject is rejected. */
+static gboolean regex_is_line_local(const gchar *str)
+{
+	const gchar *p;
+
+	for (p = str; *p; p++)
+	{
+		if ((guchar) *p < 0x20)
+			return FALSE;
+		if (*p == '\\')
+		{
+			p++;
+			if (! *p)
+				return FALSE;
+			/* backreferences, but not octal escapes */
+			if (*p >= '1' && *p <= '9' && ! g_ascii_isdigit(p[1]))
+				continue;
+			/* word, digit, non-space, word boundary and non-newline escapes are fine, others
+			 * like \s, \n, \x, \W, \p or \A aren't */
+			if (g_ascii_isalnum(*p) && ! strchr("wdSbBNhK", *p))
+				return FALSE;
+		}
+		else if (*p == '[' && (p[1] == '^' || p[1] == ':'))
+			return FALSE;
+		else if (*p == '(' && p[1] == '?')
+		{
+			const gchar *opt = p + 2;
+
+			if (strchr(":=!<>|P#", *opt))
+				continue;
+			/* inline options, dotall mode would match line breaks */
+			for (; *opt && strchr("imxJU-", *opt); opt++);
+			if (*opt != ')' && *opt != ':')
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 static GRegex *compile_regex(const gchar *str, GeanyFindFlags sflags)
 {
 	GRegex *regex;
@@ -1861,6 +2171,13 @@ static GRegex *compile_regex(const gchar *str, GeanyFindFlags sflags)
 
 	if (sflags & GEANY_FIND_MULTILINE)
 		rflags |= G_REGEX_MULTILINE;
+#if GLIB_CHECK_VERSION(2, 34, 0)
+	else if (regex_is_line_local(str))
+	{
+		/* matched against the whole buffer at once, see find_regex() */
+		rflags |= G_REGEX_MULTILINE | G_REGEX_NEWLINE_ANYCRLF | G_REGEX_OPTIMIZE;
+	}
+#endif
 	if (~sflags & GEANY_FIND_MATCHCASE)
 		rflags |= G_REGEX_CASELESS;
 	if (sflags & (GEANY_FIND_WHOLEWORD | GEANY_FIND_WORDSTART))
@@ -1905,6 +2222,28 @@ static gint find_regex(ScintillaObject *sci, guint pos, GRegex *regex, gboolean
 		text = (void*)scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
 		g_regex_match_full(regex, text, -1, pos, 0, &minfo, NULL);
 	}
+	else if (g_regex_get_compile_flags(regex) & G_REGEX_MULTILINE)
+	{
+		/* single-line mode with a pattern that can't match across lines, so it is run over the
+		 * whole buffer with ^ and $ matching at line breaks instead of line by line */
+		text = (void*)scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+		for (;;)
+		{
+			gint start;
+
+			g_regex_match_full(regex, text, document_length, pos, 0, &minfo, NULL);
+			if (! g_match_info_matches(minfo) || ! g_match_info_fetch_pos(minfo, 0, &start, NULL))
+				break;
+			/* an empty match between CR and LF isn't inside any line */
+			if (start > 0 && text[start - 1] == '\r' && text[start] == '\n')
+			{
+				pos = start + 1;
+				g_match_info_free(minfo);
+				continue;
+			}
+			break;
+		}
+	}
 	else /* single-line mode, manually match against each line */
 	{
 		gint line = sci_get_line_from_position(sci, pos);
@@ -2061,6 +2400,190 @@ gint search_replace_match(ScintillaObject *sci, const GeanyMatchInfo *match, con
 	return ret;
 }
 
+/* Word character classes like Scintilla's CharClassify, only for ASCII */
+enum
+{
+	CHAR_CLASS_SPACE,
+	CHAR_CLASS_NEWLINE,
+	CHAR_CLASS_WORD,
+	CHAR_CLASS_PUNCTUATION,
+	CHAR_CLASS_UNKNOWN
+};
+
+static void set_char_classes(ScintillaObject *sci, guint8 *classes, gint message, guint8 cls)
+{
+	guchar chars[257];
+	gint i, n;
+
+	n = (gint) scintilla_send_message(sci, message, 0, (sptr_t) chars);
+	for (i = 0; i < n && i < 256; i++)
+	{
+		if (chars[i] < 0x80)
+			classes[chars[i]] = cls;
+	}
+}
+
+static void get_char_classes(ScintillaObject *sci, guint8 classes[128])
+{
+	memset(classes, CHAR_CLASS_SPACE, 128);
+	set_char_classes(sci, classes, SCI_GETWORDCHARS, CHAR_CLASS_WORD);
+	set_char_classes(sci, classes, SCI_GETPUNCTUATIONCHARS, CHAR_CLASS_PUNCTUATION);
+	classes['\r'] = classes['\n'] = CHAR_CLASS_NEWLINE;
+}
+
+static inline guint8 char_class(const guint8 classes[128], guchar c)
+{
+	return c < 0x80 ? classes[c] : CHAR_CLASS_UNKNOWN;
+}
+
+/* Returns whether one of the classes is a word edge as in Scintilla's Document::IsWordEdge(),
+ * or -1 when it can't be decided without decoding a non-ASCII character */
+static gint is_word_edge(guint8 cls, guint8 cls_next)
+{
+	if (cls == CHAR_CLASS_UNKNOWN || cls_next == CHAR_CLASS_UNKNOWN)
+		return -1;
+	return cls != cls_next && (cls == CHAR_CLASS_WORD || cls == CHAR_CLASS_PUNCTUATION);
+}
+
+/* Document::IsWordStartAt(), the start of the document counts as a space before it */
+static gint is_word_start_at(const guint8 classes[128], const gchar *buf, gint length, gint pos)
+{
+	guint8 before;
+
+	if (pos >= length)
+		return FALSE;
+	before = char_class(classes, pos > 0 ? buf[pos - 1] : ' ');
+	return is_word_edge(char_class(classes, buf[pos]), before);
+}
+
+/* Document::IsWordEndAt(), the end of the document counts as a space after it, so a word or
+ * punctuation character at the end is a word end */
+static gint is_word_end_at(const guint8 classes[128], const gchar *buf, gint length, gint pos)
+{
+	guint8 after;
+
+	if (pos <= 0)
+		return FALSE;
+	after = char_class(classes, pos < length ? buf[pos] : ' ');
+	return is_word_edge(char_class(classes, buf[pos - 1]), after);
+}
+
+/* Checks SCFIND_WHOLEWORD and SCFIND_WORDSTART like Scintilla's Document::MatchesWordOptions(),
+ * returns -1 if a neighbouring character is not ASCII */
+static gint matches_word_options(const guint8 classes[128], const gchar *buf, gint length,
+		gint pos, gint len, gint sci_flags)
+{
+	gint start, end;
+
+	start = is_word_start_at(classes, buf, length, pos);
+	if (sci_flags & SCFIND_WORDSTART && start == TRUE)
+		return TRUE;
+	if (! (sci_flags & SCFIND_WHOLEWORD))
+		return start;
+
+	/* Document::IsWordAt() */
+	end = len > 0 ? is_word_end_at(classes, buf, length, pos + len) : FALSE;
+	if (start == FALSE || end == FALSE)
+		return sci_flags & SCFIND_WORDSTART ? start : FALSE;
+	if (start == -1 || end == -1)
+		return -1;
+	return TRUE;
+}
+
+/* Like sci_find_text(), but forward case sensitive searches are done directly on the document
+ * buffer with memchr() and memcmp(), and the word options are only checked at candidates.
+ * Scintilla's FindText() does the same, but walks the gap buffer and is called once per match. */
+gint search_find_literal(ScintillaObject *sci, gint sci_flags, struct Sci_TextToFind *ttf)
+{
+	const gchar *text = ttf->lpstrText;
+	const gchar *buf, *p, *last;
+	gsize text_len;
+	gint length, end;
+	guint8 classes[128];
+	gboolean have_classes = FALSE;
+
+	text_len = strlen(text);
+	length = sci_get_length(sci);
+	end = MIN(ttf->chrg.cpMax, length);
+
+	/* a search text starting with a UTF-8 trail byte could match in the middle of a character */
+	if (! (sci_flags & SCFIND_MATCHCASE) || sci_flags & SCFIND_REGEXP || text_len == 0 ||
+		ttf->chrg.cpMin < 0 || ttf->chrg.cpMin > end || ((guchar) text[0] & 0xC0) == 0x80)
+	{
+		return sci_find_text(sci, sci_flags, ttf);
+	}
+	if ((gsize) (end - ttf->chrg.cpMin) < text_len)
+		return -1;
+
+	buf = sci_get_character_pointer(sci);
+	p = buf + ttf->chrg.cpMin;
+	last = buf + end - text_len;
+	while (p <= last && (p = memchr(p, text[0], last - p + 1)) != NULL)
+	{
+		if (memcmp(p + 1, text + 1, text_len - 1) == 0)
+		{
+			gint pos = p - buf;
+			gint matches = TRUE;
+
+			if (sci_flags & (SCFIND_WHOLEWORD | SCFIND_WORDSTART))
+			{
+				if (! have_classes)
+				{
+					get_char_classes(sci, classes);
+					have_classes = TRUE;
+				}
+				matches = matches_word_options(classes, buf, length, pos, text_len, sci_flags);
+				if (matches == -1)
+				{
+					/* let Scintilla classify the non-ASCII characters around this candidate */
+					struct Sci_TextToFind candidate = *ttf;
+
+					candidate.chrg.cpMin = pos;
+					candidate.chrg.cpMax = pos + text_len;
+					matches = sci_find_text(sci, sci_flags, &candidate) == pos;
+				}
+			}
+			if (matches)
+			{
+				ttf->chrgText.cpMin = pos;
+				ttf->chrgText.cpMax = pos + text_len;
+				return pos;
+			}
+		}
+		p++;
+	}
+	return -1;
+}
+
+/* Finds the first match in ttf's range and fills in ttf->chrgText and match.
+ * regex must be compiled from ttf->lpstrText for regex searches and NULL otherwise. */
+static gint find_match(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_TextToFind *ttf,
+		GRegex *regex, GeanyMatchInfo *match)
+{
+	gint ret;
+
+	if (regex == NULL)
+	{
+		ret = search_find_literal(sci, geany_find_flags_to_sci_flags(flags), ttf);
+		if (ret != -1)
+		{
+			match->start = ttf->chrgText.cpMin;
+			match->end = ttf->chrgText.cpMax;
+		}
+		return ret;
+	}
+
+	ret = find_regex(sci, ttf->chrg.cpMin, regex, flags & GEANY_FIND_MULTILINE, match);
+	if (ret >= ttf->chrg.cpMax)
+		ret = -1;
+	else if (ret >= 0)
+	{
+		ttf->chrgText.cpMin = match->start;
+		ttf->chrgText.cpMax = match->end;
+	}
+	return ret;
+}
+
 gint search_find_text(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_TextToFind *ttf, GeanyMatchInfo **match_)
 {
 	GeanyMatchInfo *match = NULL;
@@ -2069,7 +2592,7 @@ gint search_find_text(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_Tex
 
 	if (~flags & GEANY_FIND_REGEXP)
 	{
-		ret = sci_find_text(sci, geany_find_flags_to_sci_flags(flags), ttf);
+		ret = search_find_literal(sci, geany_find_flags_to_sci_flags(flags), ttf);
 		if (ret != -1 && match_)
 			*match_ = match_info_new(flags, ttf->chrgText.cpMin, ttf->chrgText.cpMax);
 		return ret;
@@ -2080,15 +2603,7 @@ gint search_find_text(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_Tex
 		return -1;
 
 	match = match_info_new(flags, 0, 0);
-
-	ret = find_regex(sci, ttf->chrg.cpMin, regex, flags & GEANY_FIND_MULTILINE, match);
-	if (ret >= ttf->chrg.cpMax)
-		ret = -1;
-	else if (ret >= 0)
-	{
-		ttf->chrgText.cpMin = match->start;
-		ttf->chrgText.cpMax = match->end;
-	}
+	ret = find_match(sci, flags, ttf, regex, match);
 
 	if (ret != -1 && match_)
 		*match_ = match;
@@ -2099,44 +2614,88 @@ gint search_find_text(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_Tex
 	return ret;
 }
 
+typedef struct
+{
+	GeanyDocument *doc;
+	gchar *short_file_name;
+	gint end;
+	gint prev_line;
+	gint count;
+}
+UsageData;
+
+static void add_usage(UsageData *data, gint pos)
+{
+	ScintillaObject *sci = data->doc->editor->sci;
+	gint line = sci_get_line_from_position(sci, pos);
+
+	if (line != data->prev_line)
+	{
+		gchar *buffer = sci_get_line(sci, line);
+		gchar *msg = g_strdup_printf("%s:%d: %s", data->short_file_name, line + 1,
+			g_strstrip(buffer));
+
+		msgwin_msg_add_queued(COLOR_BLACK, line + 1, data->doc, msg);
+		g_free(msg);
+		g_free(buffer);
+		data->prev_line = line;
+	}
+	data->count++;
+}
+
+static gboolean add_usage_match(GeanyMatchInfo *match, gpointer user_data)
+{
+	UsageData *data = user_data;
+
+	/* found text is partially out of range */
+	if (match->end > data->end)
+		return FALSE;
+
+	add_usage(data, match->start);
+	return TRUE;
+}
+
 static gint find_document_usage_range(GeanyDocument *doc, const gchar *search_text,
 		GeanyFindFlags flags, gint start, gint end)
 {
-	gchar *buffer, *short_file_name;
 	struct Sci_TextToFind ttf;
-	gint count = 0;
-	gint prev_line = -1;
-	GSList *match, *matches;
+	UsageData data;
 
 	g_return_val_if_fail(DOC_VALID(doc), 0);
 
-	short_file_name = g_path_get_basename(DOC_FILENAME(doc));
+	data.doc = doc;
+	data.short_file_name = g_path_get_basename(DOC_FILENAME(doc));
+	data.end = end;
+	data.prev_line = -1;
+	data.count = 0;
 
 	ttf.chrg.cpMin = start;
 	ttf.chrg.cpMax = end;
 	ttf.lpstrText = (gchar *)search_text;
 
-	matches = find_range(doc->editor->sci, flags, &ttf);
-	foreach_slist (match, matches)
-	{
-		GeanyMatchInfo *info = match->data;
-		gint line = sci_get_line_from_position(doc->editor->sci, info->start);
+	foreach_match(doc->editor->sci, flags, &ttf, add_usage_match, &data);
 
-		if (line != prev_line)
-		{
-			buffer = sci_get_line(doc->editor->sci, line);
-			msgwin_msg_add(COLOR_BLACK, line + 1, doc,
-				"%s:%d: %s", short_file_name, line + 1, g_strstrip(buffer));
-			g_free(buffer);
-			prev_line = line;
-		}
-		count++;
+	g_free(data.short_file_name);
+	return data.count;
+}
 
-		geany_match_info_free(info);
-	}
-	g_slist_free(matches);
-	g_free(short_file_name);
-	return count;
+/* Adds the matches found by search_session_documents() */
+static gint add_document_usage(GeanyDocument *doc, GArray *matches)
+{
+	UsageData data;
+	guint i;
+
+	data.doc = doc;
+	data.short_file_name = g_path_get_basename(DOC_FILENAME(doc));
+	data.end = sci_get_length(doc->editor->sci);
+	data.prev_line = -1;
+	data.count = 0;
+
+	for (i = 0; i < matches->len; i++)
+		add_usage(&data, g_array_index(matches, gint, i));
+
+	g_free(data.short_file_name);
+	return data.count;
 }
 
 static gint find_document_usage(GeanyDocument *doc, const gchar *search_text, GeanyFindFlags flags,
@@ -2205,7 +2764,7 @@ void search_find_usage(const gchar *search_text, const gchar *original_search_te
 	}
 
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_MESSAGE);
-	gtk_list_store_clear(msgwindow.store_msg);
+	msgwin_clear_tab(MSG_MESSAGE);
 
 	switch (context)
 	{
@@ -2216,9 +2775,22 @@ void search_find_usage(const gchar *search_text, const gchar *original_search_te
 			count = find_document_usage(doc, search_text, flags, TRUE);
 			break;
 		case GEANY_FIND_CONTEXT_SESSION:
-			foreach_ordered_document(doc)
-				count += find_document_usage(doc, search_text, flags, FALSE);
+		{
+			GArray *items = search_session_documents(search_text, flags, TRUE);
+			guint i;
+
+			for (i = 0; i < items->len; i++)
+			{
+				SessionSearchItem *item = &g_array_index(items, SessionSearchItem, i);
+
+				if (item->matches != NULL)
+					count += add_document_usage(item->doc, item->matches);
+				else
+					count += find_document_usage(item->doc, search_text, flags, FALSE);
+			}
+			session_search_items_free(items);
 			break;
+		}
 	}
 
 	if (count == 0) /* no matches were found */
@@ -2237,24 +2809,49 @@ void search_find_usage(const gchar *search_text, const gchar *original_search_te
 	}
 }
 
+typedef struct
+{
+	GArray *matches;
+	gint end;
+}
+ReplaceData;
+
+static gboolean collect_replace_match(GeanyMatchInfo *match, gpointer user_data)
+{
+	ReplaceData *data = user_data;
+	GeanyMatchInfo copy = *match;
+
+	/* found text is partially out of range */
+	if (match->end > data->end)
+		return FALSE;
+
+	copy.match_text = g_strdup(match->match_text);
+	g_array_append_val(data->matches, copy);
+	return TRUE;
+}
+
 /* ttf is updated to include the last match position (ttf->chrg.cpMin) and
  * the new search range end (ttf->chrg.cpMax).
  * Note: Normally you would call sci_start/end_undo_action() around this call. */
 guint search_replace_range(ScintillaObject *sci, struct Sci_TextToFind *ttf,
 		GeanyFindFlags flags, const gchar *replace_text)
 {
-	gint count = 0;
 	gint offset = 0; /* difference between search pos and replace pos */
-	GSList *match, *matches;
+	ReplaceData data;
+	guint i, count;
 
 	g_return_val_if_fail(sci != NULL && ttf->lpstrText != NULL && replace_text != NULL, 0);
 	if (! *ttf->lpstrText)
 		return 0;
 
-	matches = find_range(sci, flags, ttf);
-	foreach_slist (match, matches)
+	/* all matches are found before replacing, as replacements could create new matches */
+	data.matches = g_array_new(FALSE, FALSE, sizeof(GeanyMatchInfo));
+	data.end = ttf->chrg.cpMax;
+	foreach_match(sci, flags, ttf, collect_replace_match, &data);
+
+	for (i = 0; i < data.matches->len; i++)
 	{
-		GeanyMatchInfo *info = match->data;
+		GeanyMatchInfo *info = &g_array_index(data.matches, GeanyMatchInfo, i);
 		gint replace_len;
 
 		info->start += offset;
@@ -2262,18 +2859,17 @@ guint search_replace_range(ScintillaObject *sci, struct Sci_TextToFind *ttf,
 
 		replace_len = search_replace_match(sci, info, replace_text);
 		offset += replace_len - (info->end - info->start);
-		count ++;
 
 		/* on last match, update the last match/new range end */
-		if (! match->next)
+		if (i == data.matches->len - 1)
 		{
 			ttf->chrg.cpMin = info->start;
 			ttf->chrg.cpMax += offset;
 		}
-
-		geany_match_info_free(info);
+		g_free(info->match_text);
 	}
-	g_slist_free(matches);
+	count = data.matches->len;
+	g_array_free(data.matches, TRUE);
 
 	return count;
 }
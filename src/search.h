@@ -60,6 +60,8 @@ typedef struct GeanySearchPrefs
 	gboolean	hide_find_dialog;		/* hide the find dialog on next or previous */
 	gboolean	replace_and_find_by_default;	/* enter in replace window performs Replace & Find instead of Replace */
 	GeanyFindSelOptions find_selection_type;
+	gboolean	use_builtin_find_in_files;	/* search in-process instead of spawning grep */
+	gboolean	use_find_in_files_index;	/* keep a trigram index of the project files */
 }
 GeanySearchPrefs;
 
@@ -129,6 +131,8 @@ gint search_find_next(struct _ScintillaObject *sci, const gchar *str, GeanyFindF
 
 gint search_find_text(struct _ScintillaObject *sci, GeanyFindFlags flags, struct Sci_TextToFind *ttf, GeanyMatchInfo **match_);
 
+gint search_find_literal(struct _ScintillaObject *sci, gint sci_flags, struct Sci_TextToFind *ttf);
+
 void search_find_again(gboolean change_direction);
 
 void search_find_usage(const gchar *search_text, const gchar *original_search_text,
@@ -139,6 +143,9 @@ void search_find_selection(struct GeanyDocument *doc, gboolean search_backwards)
 gint search_highlight_all(struct _ScintillaObject *doc, const gchar *search_text, GeanyFindFlags flags,
 		gint indicator, gboolean clear_mode);
 
+gint search_highlight_range(struct _ScintillaObject *sci, const gchar *search_text,
+		GeanyFindFlags flags, gint indicator, gboolean clear_mode, gint start, gint end, gint *resume);
+
 gint search_replace_match(struct _ScintillaObject *sci, const GeanyMatchInfo *match, const gchar *replace_text);
 
 guint search_replace_range(struct _ScintillaObject *sci, struct Sci_TextToFind *ttf,
@@ -0,0 +1,608 @@
+/*
+ *      searchindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Trigram index of the files below the project base path, used by Find in Files to skip files
+ * which can't contain the search text.
+ *
+ * For every file, the trigrams of its contents (with ASCII letters folded to lower case) are
+ * stored in a small Bloom filter together with the file's modification time and size. A file
+ * whose filter lacks one of the search text's trigrams can't match; false positives only cost
+ * a search of the file. Files are (re)indexed while they are searched, when they are saved and
+ * when the directory watcher reports a change. The index is kept in Geany's configuration
+ * directory, one file per project.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "searchindex.h"
+
+#include "app.h"
+#include "document.h"
+#include "geany.h"
+#include "geanyobject.h"
+#include "project.h"
+#include "search.h"
+#include "utils.h"
+
+#include "tm_source_file.h"
+
+#include <string.h>
+#include <stdlib.h>
+/* gstdio.h also includes sys/stat.h */
+#include <glib/gstdio.h>
+
+
+#define INDEX_MAGIC "GEANYIDX"
+#define INDEX_VERSION 2
+/* larger files aren't indexed, as collecting their trigrams needs 4 bytes per byte */
+#define MAX_FILE_SIZE (16 * 1024 * 1024)
+/* files with a NUL byte in this many first bytes are binary, like in Find in Files */
+#define BINARY_CHECK_SIZE 32768
+/* filter bits per distinct trigram, before rounding up to a power of 2. With two hash
+ * functions this gives about 5% false positives per trigram, which is enough as search texts
+ * usually have several trigrams. */
+#define BITS_PER_TRIGRAM 6
+#define MIN_BITS_LOG2 6
+#define MAX_BITS_LOG2 24
+
+
+typedef struct IndexEntry
+{
+	gint64	mtime;		/* in microseconds, see searchindex_get_mtime() */
+	gint64	size;
+	guint8	bits_log2;	/* 0 for binary files */
+	guint8	bits[];
+}
+IndexEntry;
+
+struct SearchIndex
+{
+	gint		 ref_count;
+	GMutex		 lock;		/* protects entries and dirty */
+	gchar		*root;		/* real path of the project base path, with a trailing separator */
+	gsize		 root_len;
+	gchar		*filename;	/* where the index is stored */
+	GHashTable	*entries;	/* path relative to root -> IndexEntry */
+	gboolean	 dirty;
+};
+
+
+static SearchIndex *project_index = NULL;
+
+
+static inline gsize entry_bits_size(guint8 bits_log2)
+{
+	return bits_log2 > 0 ? (gsize) 1 << (bits_log2 - 3) : 0;
+}
+
+
+static inline guint32 trigram_hash1(guint32 trigram)
+{
+	return trigram * 0x9E3779B1u;
+}
+
+
+static inline guint32 trigram_hash2(guint32 trigram)
+{
+	return (trigram ^ (trigram >> 11)) * 0x85EBCA6Bu;
+}
+
+
+static inline void set_bit(IndexEntry *entry, guint32 hash)
+{
+	guint32 bit = hash >> (32 - entry->bits_log2);
+
+	entry->bits[bit >> 3] |= 1 << (bit & 7);
+}
+
+
+static inline gboolean test_bit(const IndexEntry *entry, guint32 hash)
+{
+	guint32 bit = hash >> (32 - entry->bits_log2);
+
+	return (entry->bits[bit >> 3] & (1 << (bit & 7))) != 0;
+}
+
+
+static gint compare_trigrams(gconstpointer a, gconstpointer b)
+{
+	guint32 ta = *(const guint32 *) a;
+	guint32 tb = *(const guint32 *) b;
+
+	return ta < tb ? -1 : ta > tb;
+}
+
+
+/* Returns the sorted distinct trigrams of data, with ASCII letters folded to lower case.
+ * If caseless is set, only trigrams are kept which can't match other text when folding the
+ * case of Unicode characters: this excludes non-ASCII bytes, and also K and S as they match
+ * the Kelvin and long s signs. */
+static GArray *collect_trigrams(const gchar *data, gsize len, gboolean caseless)
+{
+	GArray *trigrams = g_array_sized_new(FALSE, FALSE, sizeof(guint32), len > 2 ? len - 2 : 0);
+	guint32 trigram = 0;
+	guint32 *t;
+	gsize i, j, skip = 2;
+
+	for (i = 0; i < len; i++)
+	{
+		guchar c = g_ascii_tolower(data[i]);
+
+		trigram = ((trigram << 8) | c) & 0xFFFFFF;
+		if (caseless && (c >= 0x80 || c == 'k' || c == 's'))
+			skip = 3;
+		if (skip > 0)
+		{
+			skip--;
+			continue;
+		}
+		g_array_append_val(trigrams, trigram);
+	}
+	if (trigrams->len < 2)
+		return trigrams;
+
+	qsort(trigrams->data, trigrams->len, sizeof(guint32), compare_trigrams);
+	t = (guint32 *) trigrams->data;
+	for (i = 1, j = 0; i < trigrams->len; i++)
+	{
+		if (t[i] != t[j])
+			t[++j] = t[i];
+	}
+	g_array_set_size(trigrams, j + 1);
+	return trigrams;
+}
+
+
+static IndexEntry *entry_new(gint64 mtime, gint64 size, const gchar *data, gsize len,
+		gboolean binary)
+{
+	IndexEntry *entry;
+	GArray *trigrams = NULL;
+	guint8 bits_log2 = 0;
+	guint i;
+
+	if (! binary)
+	{
+		trigrams = collect_trigrams(data, len, FALSE);
+		bits_log2 = MIN_BITS_LOG2;
+		while (bits_log2 < MAX_BITS_LOG2 &&
+			((guint64) 1 << bits_log2) < (guint64) trigrams->len * BITS_PER_TRIGRAM)
+		{
+			bits_log2++;
+		}
+	}
+
+	entry = g_malloc0(sizeof(IndexEntry) + entry_bits_size(bits_log2));
+	entry->mtime = mtime;
+	entry->size = size;
+	entry->bits_log2 = bits_log2;
+
+	if (trigrams != NULL)
+	{
+		for (i = 0; i < trigrams->len; i++)
+		{
+			guint32 trigram = g_array_index(trigrams, guint32, i);
+
+			set_bit(entry, trigram_hash1(trigram));
+			set_bit(entry, trigram_hash2(trigram));
+		}
+		g_array_free(trigrams, TRUE);
+	}
+	return entry;
+}
+
+
+static gboolean entry_may_contain(const IndexEntry *entry, GArray *trigrams)
+{
+	guint i;
+
+	for (i = 0; i < trigrams->len; i++)
+	{
+		guint32 trigram = g_array_index(trigrams, guint32, i);
+
+		if (! test_bit(entry, trigram_hash1(trigram)) || ! test_bit(entry, trigram_hash2(trigram)))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+
+/* Returns the path relative to the index root, or NULL if it's outside */
+static const gchar *get_relative_path(SearchIndex *index, const gchar *real_path)
+{
+	if (strncmp(real_path, index->root, index->root_len) != 0)
+		return NULL;
+	return real_path + index->root_len;
+}
+
+
+/* The file format is the magic, the version, a byte order mark and the root path, followed
+ * by the entries. Strings are prefixed with their length and numbers are in host byte order,
+ * as the index is only a cache. */
+static void append_data(GByteArray *buf, gconstpointer data, gsize len)
+{
+	g_byte_array_append(buf, data, len);
+}
+
+
+static void append_string(GByteArray *buf, const gchar *str)
+{
+	guint32 len = strlen(str);
+
+	append_data(buf, &len, sizeof(len));
+	append_data(buf, str, len);
+}
+
+
+static void index_save(SearchIndex *index)
+{
+	GByteArray *buf;
+	GHashTableIter iter;
+	gpointer key, value;
+	guint32 version = INDEX_VERSION;
+	guint32 bom = 0x01020304;
+	gchar *dir;
+
+	g_mutex_lock(&index->lock);
+	if (! index->dirty)
+	{
+		g_mutex_unlock(&index->lock);
+		return;
+	}
+
+	buf = g_byte_array_new();
+	append_data(buf, INDEX_MAGIC, strlen(INDEX_MAGIC));
+	append_data(buf, &version, sizeof(version));
+	append_data(buf, &bom, sizeof(bom));
+	append_string(buf, index->root);
+
+	g_hash_table_iter_init(&iter, index->entries);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		IndexEntry *entry = value;
+
+		append_string(buf, key);
+		append_data(buf, &entry->mtime, sizeof(entry->mtime));
+		append_data(buf, &entry->size, sizeof(entry->size));
+		append_data(buf, &entry->bits_log2, sizeof(entry->bits_log2));
+		append_data(buf, entry->bits, entry_bits_size(entry->bits_log2));
+	}
+	index->dirty = FALSE;
+	g_mutex_unlock(&index->lock);
+
+	dir = g_path_get_dirname(index->filename);
+	utils_mkdir(dir, TRUE);
+	g_free(dir);
+	if (! g_file_set_contents(index->filename, (const gchar *) buf->data, buf->len, NULL))
+		geany_debug("Could not write search index %s", index->filename);
+	g_byte_array_free(buf, TRUE);
+}
+
+
+static gboolean read_data(const gchar **p, const gchar *end, gpointer data, gsize len)
+{
+	if ((gsize) (end - *p) < len)
+		return FALSE;
+	memcpy(data, *p, len);
+	*p += len;
+	return TRUE;
+}
+
+
+static gchar *read_string(const gchar **p, const gchar *end)
+{
+	guint32 len;
+	gchar *str;
+
+	if (! read_data(p, end, &len, sizeof(len)) || (gsize) (end - *p) < len)
+		return NULL;
+	str = g_strndup(*p, len);
+	*p += len;
+	return str;
+}
+
+
+/* Reads the entries of a previously saved index, an invalid or outdated file is ignored */
+static void index_load(SearchIndex *index)
+{
+	gchar *contents, *root, *path;
+	const gchar *p, *end;
+	gsize len;
+	guint32 version, bom;
+	IndexEntry header;
+
+	if (! g_file_get_contents(index->filename, &contents, &len, NULL))
+		return;
+
+	p = contents;
+	end = contents + len;
+	if (len < strlen(INDEX_MAGIC) || strncmp(p, INDEX_MAGIC, strlen(INDEX_MAGIC)) != 0)
+		goto done;
+	p += strlen(INDEX_MAGIC);
+	if (! read_data(&p, end, &version, sizeof(version)) || version != INDEX_VERSION ||
+		! read_data(&p, end, &bom, sizeof(bom)) || bom != 0x01020304)
+	{
+		goto done;
+	}
+	root = read_string(&p, end);
+	if (! utils_str_equal(root, index->root))
+	{
+		g_free(root);
+		goto done;
+	}
+	g_free(root);
+
+	while (p < end && (path = read_string(&p, end)) != NULL)
+	{
+		IndexEntry *entry;
+		gsize bits_size;
+
+		if (! read_data(&p, end, &header.mtime, sizeof(header.mtime)) ||
+			! read_data(&p, end, &header.size, sizeof(header.size)) ||
+			! read_data(&p, end, &header.bits_log2, sizeof(header.bits_log2)) ||
+			(header.bits_log2 != 0 && (header.bits_log2 < MIN_BITS_LOG2 ||
+				header.bits_log2 > MAX_BITS_LOG2)))
+		{
+			g_free(path);
+			break;
+		}
+		bits_size = entry_bits_size(header.bits_log2);
+		entry = g_malloc(sizeof(IndexEntry) + bits_size);
+		*entry = header;
+		if (! read_data(&p, end, entry->bits, bits_size))
+		{
+			g_free(entry);
+			g_free(path);
+			break;
+		}
+		g_hash_table_insert(index->entries, path, entry);
+	}
+
+done:
+	g_free(contents);
+}
+
+
+static SearchIndex *index_new(const gchar *real_base_path, const gchar *project_file)
+{
+	SearchIndex *index = g_new0(SearchIndex, 1);
+	gchar *name;
+
+	index->ref_count = 1;
+	g_mutex_init(&index->lock);
+	index->root = g_str_has_suffix(real_base_path, G_DIR_SEPARATOR_S) ?
+		g_strdup(real_base_path) : g_strconcat(real_base_path, G_DIR_SEPARATOR_S, NULL);
+	index->root_len = strlen(index->root);
+	index->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	name = g_compute_checksum_for_string(G_CHECKSUM_MD5, project_file, -1);
+	index->filename = g_build_filename(app->configdir, "searchindex", name, NULL);
+	g_free(name);
+
+	index_load(index);
+	return index;
+}
+
+
+void searchindex_unref(SearchIndex *index)
+{
+	if (index != NULL && g_atomic_int_dec_and_test(&index->ref_count))
+	{
+		g_hash_table_destroy(index->entries);
+		g_mutex_clear(&index->lock);
+		g_free(index->root);
+		g_free(index->filename);
+		g_free(index);
+	}
+}
+
+
+/* Returns a new reference to the index of the current project if real_dir is inside its base
+ * path and the index is enabled, otherwise NULL. The index is loaded on first use. */
+SearchIndex *searchindex_get(const gchar *real_dir)
+{
+	gchar *base_path, *locale_path, *real_path, *dir;
+
+	if (! search_prefs.use_find_in_files_index || app->project == NULL)
+		return NULL;
+
+	if (project_index == NULL)
+	{
+		base_path = project_get_base_path();
+		if (base_path == NULL)
+			return NULL;
+		locale_path = utils_get_locale_from_utf8(base_path);
+		real_path = tm_get_real_path(locale_path);
+		if (real_path != NULL && g_file_test(real_path, G_FILE_TEST_IS_DIR))
+			project_index = index_new(real_path, app->project->file_name);
+		g_free(real_path);
+		g_free(locale_path);
+		g_free(base_path);
+		if (project_index == NULL)
+			return NULL;
+	}
+
+	dir = g_str_has_suffix(real_dir, G_DIR_SEPARATOR_S) ? g_strdup(real_dir) :
+		g_strconcat(real_dir, G_DIR_SEPARATOR_S, NULL);
+	if (get_relative_path(project_index, dir) == NULL)
+	{
+		g_free(dir);
+		return NULL;
+	}
+	g_free(dir);
+
+	g_atomic_int_inc(&project_index->ref_count);
+	return project_index;
+}
+
+
+/* Returns the trigrams needed for a match of the plain search text text, or NULL if it's
+ * too short to rule out any file */
+GArray *searchindex_get_trigrams(const gchar *text, gboolean case_sensitive)
+{
+	GArray *trigrams = collect_trigrams(text, strlen(text), ! case_sensitive);
+
+	if (trigrams->len == 0)
+	{
+		g_array_free(trigrams, TRUE);
+		return NULL;
+	}
+	return trigrams;
+}
+
+
+/* Returns the modification time of a file in microseconds. Files are often rewritten within
+ * a second, so whole seconds aren't enough to notice changes where the size stays the same. */
+gint64 searchindex_get_mtime(const GStatBuf *st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	return (gint64) st->st_mtim.tv_sec * G_USEC_PER_SEC + st->st_mtim.tv_nsec / 1000;
+#else
+	return (gint64) st->st_mtime * G_USEC_PER_SEC;
+#endif
+}
+
+
+/* Checks whether the indexed file at real_path could contain all of the trigrams, if its
+ * entry is still up to date. trigrams can be NULL to only check the entry. */
+SearchIndexResult searchindex_lookup(SearchIndex *index, const gchar *real_path, gint64 mtime,
+		gint64 size, GArray *trigrams)
+{
+	const gchar *rel_path = get_relative_path(index, real_path);
+	SearchIndexResult result = SEARCH_INDEX_UNKNOWN;
+	IndexEntry *entry;
+
+	if (rel_path == NULL)
+		return SEARCH_INDEX_MAYBE;
+
+	g_mutex_lock(&index->lock);
+	entry = g_hash_table_lookup(index->entries, rel_path);
+	if (entry != NULL && entry->mtime == mtime && entry->size == size)
+	{
+		if (entry->bits_log2 == 0)
+			result = SEARCH_INDEX_BINARY;
+		else if (trigrams != NULL && ! entry_may_contain(entry, trigrams))
+			result = SEARCH_INDEX_NO_MATCH;
+		else
+			result = SEARCH_INDEX_MAYBE;
+	}
+	g_mutex_unlock(&index->lock);
+	return result;
+}
+
+
+/* Indexes the contents of the file at real_path. Can be called from any thread. */
+void searchindex_update(SearchIndex *index, const gchar *real_path, gint64 mtime, gint64 size,
+		const gchar *data, gsize len, gboolean binary)
+{
+	const gchar *rel_path = get_relative_path(index, real_path);
+	IndexEntry *entry;
+
+	if (rel_path == NULL || len > MAX_FILE_SIZE)
+		return;
+
+	entry = entry_new(mtime, size, data, len, binary);
+
+	g_mutex_lock(&index->lock);
+	g_hash_table_insert(index->entries, g_strdup(rel_path), entry);
+	index->dirty = TRUE;
+	g_mutex_unlock(&index->lock);
+}
+
+
+/* Drops the entry of a file reported as changed, it will be indexed again on the next search */
+void searchindex_file_changed(const gchar *locale_path)
+{
+	const gchar *rel_path;
+
+	if (project_index == NULL || locale_path == NULL)
+		return;
+
+	rel_path = get_relative_path(project_index, locale_path);
+	if (rel_path == NULL)
+		return;
+
+	g_mutex_lock(&project_index->lock);
+	if (g_hash_table_remove(project_index->entries, rel_path))
+		project_index->dirty = TRUE;
+	g_mutex_unlock(&project_index->lock);
+}
+
+
+static void on_document_save(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
+		G_GNUC_UNUSED gpointer user_data)
+{
+	GMappedFile *file;
+	const gchar *data;
+	GStatBuf st;
+	gsize len;
+
+	if (project_index == NULL || doc->real_path == NULL ||
+		get_relative_path(project_index, doc->real_path) == NULL)
+	{
+		return;
+	}
+
+	/* index what was written, which may differ from the buffer in encoding */
+	if (g_stat(doc->real_path, &st) != 0 || ! S_ISREG(st.st_mode) ||
+		(file = g_mapped_file_new(doc->real_path, FALSE, NULL)) == NULL)
+	{
+		searchindex_file_changed(doc->real_path);
+		return;
+	}
+	data = g_mapped_file_get_contents(file);
+	len = g_mapped_file_get_length(file);
+	searchindex_update(project_index, doc->real_path, searchindex_get_mtime(&st), st.st_size,
+		data, len, data != NULL && memchr(data, '\0', MIN(len, BINARY_CHECK_SIZE)) != NULL);
+	g_mapped_file_unref(file);
+}
+
+
+static void close_project_index(void)
+{
+	if (project_index != NULL)
+	{
+		index_save(project_index);
+		searchindex_unref(project_index);
+		project_index = NULL;
+	}
+}
+
+
+static void on_project_close(G_GNUC_UNUSED GObject *obj, G_GNUC_UNUSED gpointer user_data)
+{
+	close_project_index();
+}
+
+
+void searchindex_init(void)
+{
+	g_signal_connect(geany_object, "document-save", G_CALLBACK(on_document_save), NULL);
+	g_signal_connect(geany_object, "project-close", G_CALLBACK(on_project_close), NULL);
+}
+
+
+void searchindex_finalize(void)
+{
+	close_project_index();
+}
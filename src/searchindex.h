@@ -0,0 +1,63 @@
+/*
+ *      searchindex.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GEANY_SEARCHINDEX_H
+#define GEANY_SEARCHINDEX_H 1
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+G_BEGIN_DECLS
+
+typedef struct SearchIndex SearchIndex;
+
+typedef enum
+{
+	SEARCH_INDEX_UNKNOWN,	/* the file isn't indexed or has changed */
+	SEARCH_INDEX_NO_MATCH,	/* the file can't contain the search text */
+	SEARCH_INDEX_MAYBE,		/* the file has to be searched */
+	SEARCH_INDEX_BINARY		/* the file is binary */
+}
+SearchIndexResult;
+
+
+void searchindex_init(void);
+
+void searchindex_finalize(void);
+
+SearchIndex *searchindex_get(const gchar *real_dir);
+
+void searchindex_unref(SearchIndex *index);
+
+gint64 searchindex_get_mtime(const GStatBuf *st);
+
+GArray *searchindex_get_trigrams(const gchar *text, gboolean case_sensitive);
+
+SearchIndexResult searchindex_lookup(SearchIndex *index, const gchar *real_path, gint64 mtime,
+		gint64 size, GArray *trigrams);
+
+void searchindex_update(SearchIndex *index, const gchar *real_path, gint64 mtime, gint64 size,
+		const gchar *data, gsize len, gboolean binary);
+
+void searchindex_file_changed(const gchar *locale_path);
+
+G_END_DECLS
+
+#endif /* GEANY_SEARCHINDEX_H */
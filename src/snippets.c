@@ -0,0 +1,463 @@
+/*
+ *      snippets.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Compiled snippets.
+ *
+ * A snippet is compiled once into a list of tokens: runs of literal text, line breaks, the
+ * leading whitespace of each line, alignment tabs, cursor positions and template wildcards.
+ * The %special%, %newline%, %ws%, %cursor% and {pc} sequences are resolved while compiling.
+ * Expanding a snippet only has to replace the template wildcards, and to turn the line breaks,
+ * indentation and tabs into the end of line characters and indentation of the document. The
+ * values of the wildcards are compiled like text blocks, so their line breaks and indentation
+ * are turned into the document's as well. The
+ * length of the result is measured first, so it's built in a single allocation.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "snippets.h"
+
+#include "document.h"
+#include "sciwrappers.h"
+#include "templates.h"
+#include "utils.h"
+
+#include <string.h>
+
+
+typedef enum
+{
+	TOKEN_TEXT,			/* literal text */
+	TOKEN_NEWLINE,
+	TOKEN_INDENT,		/* the leading whitespace of a line */
+	TOKEN_TAB,			/* a tab after the leading whitespace, for alignment */
+	TOKEN_CURSOR,
+	TOKEN_WILDCARD		/* a template wildcard like {date}, replaced when expanding */
+}
+TokenType;
+
+typedef struct
+{
+	TokenType	type;
+	/* the text of TOKEN_TEXT and TOKEN_WILDCARD in Snippet::text, or the number of spaces and
+	 * tabs of TOKEN_INDENT */
+	guint		start;
+	guint		len;
+}
+Token;
+
+struct Snippet
+{
+	gchar	*text;
+	Token	*tokens;
+	guint	 n_tokens;
+	guint	 n_wildcards;
+};
+
+typedef struct
+{
+	GString		*text;
+	GArray		*tokens;
+	gboolean	 in_indent;		/* whether the last token is the indentation of the line */
+}
+Compiler;
+
+typedef struct
+{
+	gchar			*out;		/* NULL while measuring */
+	gsize			 len;
+	const gchar		*eol;
+	gsize			 eol_len;
+	GeanyIndentType	 indent_type;
+	gint			 indent_width;
+	gint			 tab_width;
+	gint			 newline_indent_size;
+	gboolean		 first_line;
+}
+Expansion;
+
+
+static void add_token(Compiler *c, TokenType type, guint start, guint len)
+{
+	Token token;
+
+	token.type = type;
+	token.start = start;
+	token.len = len;
+	g_array_append_val(c->tokens, token);
+	c->in_indent = type == TOKEN_INDENT;
+}
+
+
+static void compiler_init(Compiler *c)
+{
+	c->text = g_string_new(NULL);
+	c->tokens = g_array_new(FALSE, FALSE, sizeof(Token));
+	add_token(c, TOKEN_INDENT, 0, 0);
+}
+
+
+static Snippet *compiler_finish(Compiler *c)
+{
+	Snippet *snippet = g_new0(Snippet, 1);
+	guint i;
+
+	snippet->n_tokens = c->tokens->len;
+	snippet->tokens = (Token *) g_array_free(c->tokens, FALSE);
+	snippet->text = g_string_free(c->text, FALSE);
+	for (i = 0; i < snippet->n_tokens; i++)
+	{
+		if (snippet->tokens[i].type == TOKEN_WILDCARD)
+			snippet->n_wildcards++;
+	}
+	return snippet;
+}
+
+
+static void add_newline(Compiler *c)
+{
+	add_token(c, TOKEN_NEWLINE, 0, 0);
+	add_token(c, TOKEN_INDENT, 0, 0);
+}
+
+
+static void add_text(Compiler *c, const gchar *text, gsize len)
+{
+	Token *last = &g_array_index(c->tokens, Token, c->tokens->len - 1);
+
+	/* the text of the last token is at the end */
+	if (last->type == TOKEN_TEXT)
+		last->len += len;
+	else
+		add_token(c, TOKEN_TEXT, c->text->len, len);
+	g_string_append_len(c->text, text, len);
+}
+
+
+static void add_char(Compiler *c, gchar ch)
+{
+	if (c->in_indent && (ch == ' ' || ch == '\t'))
+	{
+		Token *indent = &g_array_index(c->tokens, Token, c->tokens->len - 1);
+
+		if (ch == ' ')
+			indent->start++;
+		else
+			indent->len++;
+	}
+	else if (ch == '\t')
+		add_token(c, TOKEN_TAB, 0, 0);
+	else
+		add_text(c, &ch, 1);
+}
+
+
+/* Returns the length of the template wildcard at p, or 0 if there is none */
+static gsize get_wildcard_length(const gchar *p)
+{
+	const gchar *end;
+
+	if (g_str_has_prefix(p, "{command:"))
+		end = strchr(p, '}');
+	else
+	{
+		for (end = p + 1; g_ascii_islower(*end); end++);
+		if (end == p + 1 || *end != '}')
+			end = NULL;
+	}
+	return end != NULL ? (gsize) (end - p + 1) : 0;
+}
+
+
+/* Compiles text, replacing %key% by the values of specials if it's not NULL */
+static void compile_snippet_text(Compiler *c, const gchar *text, GHashTable *specials)
+{
+	const gchar *p = text;
+
+	while (*p != '\0')
+	{
+		const gchar *end;
+		gsize len;
+
+		if (*p == '%' && (end = strchr(p + 1, '%')) != NULL)
+		{
+			gchar *name = g_strndup(p + 1, end - p - 1);
+			const gchar *value = specials ? g_hash_table_lookup(specials, name) : NULL;
+			gboolean found = TRUE;
+
+			/* nesting of specials is not supported */
+			if (value != NULL)
+				compile_snippet_text(c, value, NULL);
+			else if (strcmp(name, "newline") == 0)
+				add_newline(c);
+			else if (strcmp(name, "ws") == 0)
+				add_char(c, '\t');
+			else if (strcmp(name, "cursor") == 0)
+				add_token(c, TOKEN_CURSOR, 0, 0);
+			else
+				found = FALSE;
+			g_free(name);
+
+			if (found)
+			{
+				p = end + 1;
+				continue;
+			}
+		}
+		else if (*p == '{')
+		{
+			if (g_str_has_prefix(p, "{pc}") || g_str_has_prefix(p, "{ob}") ||
+				g_str_has_prefix(p, "{cb}"))
+			{
+				add_text(c, p[1] == 'p' ? "%" : p[1] == 'o' ? "{" : "}", 1);
+				p += 4;
+				continue;
+			}
+			len = get_wildcard_length(p);
+			if (len > 0)
+			{
+				add_token(c, TOKEN_WILDCARD, c->text->len, len);
+				g_string_append_len(c->text, p, len);
+				p += len;
+				continue;
+			}
+		}
+		else if (*p == '\n')
+		{
+			add_newline(c);
+			p++;
+			continue;
+		}
+		add_char(c, *p++);
+	}
+}
+
+
+/* Compiles a snippet, with the %key% sequences of the [Special] section in specials */
+Snippet *snippet_compile(const gchar *text, GHashTable *specials)
+{
+	Compiler c;
+
+	g_return_val_if_fail(text != NULL, NULL);
+
+	compiler_init(&c);
+	compile_snippet_text(&c, text, specials);
+	return compiler_finish(&c);
+}
+
+
+/* Compiles text for editor_insert_text_block(), which has no wildcards. newline is the line
+ * break used in text. */
+Snippet *snippet_compile_text_block(const gchar *text, gint cursor_index, const gchar *newline)
+{
+	gsize newline_len = strlen(newline);
+	const gchar *p = text;
+	Compiler c;
+
+	g_return_val_if_fail(text != NULL, NULL);
+
+	compiler_init(&c);
+	while (TRUE)
+	{
+		if (cursor_index >= 0 && p - text >= cursor_index)
+		{
+			add_token(&c, TOKEN_CURSOR, 0, 0);
+			cursor_index = -1;
+		}
+		if (*p == '\0')
+			break;
+
+		if (strncmp(p, newline, newline_len) == 0)
+		{
+			add_newline(&c);
+			p += newline_len;
+		}
+		else
+			add_char(&c, *p++);
+	}
+	return compiler_finish(&c);
+}
+
+
+void snippet_free(Snippet *snippet)
+{
+	if (snippet == NULL)
+		return;
+
+	g_free(snippet->tokens);
+	g_free(snippet->text);
+	g_free(snippet);
+}
+
+
+static void put_text(Expansion *e, const gchar *text, gsize len)
+{
+	if (e->out != NULL)
+		memcpy(e->out + e->len, text, len);
+	e->len += len;
+}
+
+
+static void put_chars(Expansion *e, gchar ch, gsize count)
+{
+	if (e->out != NULL)
+		memset(e->out + e->len, ch, count);
+	e->len += count;
+}
+
+
+/* Puts leading whitespace of width columns: with the tabs indent types as many tabs as fit,
+ * followed by spaces */
+static void put_indent(Expansion *e, gint width)
+{
+	if (e->indent_type != GEANY_INDENT_TYPE_SPACES)
+	{
+		put_chars(e, '\t', width / e->tab_width);
+		width %= e->tab_width;
+	}
+	put_chars(e, ' ', width);
+}
+
+
+/* Measures the expansion if e->out is NULL, otherwise writes it to e->out and appends the
+ * cursor positions to cursors. values are the compiled values of the wildcards. */
+static void expand_tokens(const Snippet *snippet, Expansion *e, Snippet **values, GArray *cursors)
+{
+	guint i, n_wildcard = 0;
+
+	for (i = 0; i < snippet->n_tokens; i++)
+	{
+		const Token *token = &snippet->tokens[i];
+
+		switch (token->type)
+		{
+			case TOKEN_TEXT:
+				put_text(e, snippet->text + token->start, token->len);
+				break;
+			case TOKEN_NEWLINE:
+				put_text(e, e->eol, e->eol_len);
+				e->first_line = FALSE;
+				break;
+			case TOKEN_INDENT:
+				/* tabs in the indentation are indent widths. The first line is inserted
+				 * after the existing indentation, and a wildcard value after the text
+				 * before the wildcard. */
+				put_indent(e, (e->first_line || i == 0 ? 0 : e->newline_indent_size) +
+					token->start + token->len * e->indent_width);
+				break;
+			case TOKEN_TAB:
+				if (e->indent_type == GEANY_INDENT_TYPE_TABS)
+					put_chars(e, '\t', 1);
+				else
+					put_chars(e, ' ', e->indent_width);
+				break;
+			case TOKEN_CURSOR:
+				if (e->out != NULL && cursors != NULL)
+				{
+					gint pos = (gint) e->len;
+
+					g_array_append_val(cursors, pos);
+				}
+				break;
+			case TOKEN_WILDCARD:
+				expand_tokens(values[n_wildcard++], e, NULL, cursors);
+				break;
+		}
+	}
+}
+
+
+/* Returns the compiled values of the wildcards of snippet in order */
+static Snippet **get_wildcard_values(const Snippet *snippet, GeanyDocument *doc)
+{
+	Snippet **values = g_new0(Snippet *, snippet->n_wildcards + 1);
+	guint i, n = 0;
+
+	for (i = 0; i < snippet->n_tokens; i++)
+	{
+		const Token *token = &snippet->tokens[i];
+		GString *str;
+
+		if (token->type != TOKEN_WILDCARD)
+			continue;
+
+		str = g_string_new_len(snippet->text + token->start, token->len);
+		templates_replace_common(str, doc->file_name, doc->file_type, NULL);
+		/* values like {fileheader} or {command:...} output may have any line endings */
+		utils_ensure_same_eol_characters(str, SC_EOL_LF);
+		values[n++] = snippet_compile_text_block(str->str, -1, "\n");
+		g_string_free(str, TRUE);
+	}
+	return values;
+}
+
+
+static void free_wildcard_values(Snippet **values)
+{
+	Snippet **value;
+
+	if (values == NULL)
+		return;
+
+	for (value = values; *value != NULL; value++)
+		snippet_free(*value);
+	g_free(values);
+}
+
+
+/* Returns the text of snippet for inserting into editor, with newline_indent_size columns of
+ * indentation after each line break. The byte offsets of the cursor positions in the text are
+ * appended to cursors, which can be NULL. */
+gchar *snippet_expand(const Snippet *snippet, GeanyEditor *editor, gint newline_indent_size,
+		GArray *cursors)
+{
+	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(editor);
+	Snippet **values = NULL;
+	Expansion e;
+
+	g_return_val_if_fail(snippet != NULL, NULL);
+
+	e.out = NULL;
+	e.len = 0;
+	e.eol = editor_get_eol_char(editor);
+	e.eol_len = strlen(e.eol);
+	e.indent_type = iprefs->type;
+	e.indent_width = iprefs->width;
+	/* for tabs+spaces mode we want the real tab width, not indent width */
+	e.tab_width = MAX(sci_get_tab_width(editor->sci), 1);
+	e.newline_indent_size = MAX(newline_indent_size, 0);
+
+	if (snippet->n_wildcards > 0)
+		values = get_wildcard_values(snippet, editor->document);
+
+	e.first_line = TRUE;
+	expand_tokens(snippet, &e, values, NULL);
+	e.out = g_malloc(e.len + 1);
+	e.len = 0;
+	e.first_line = TRUE;
+	expand_tokens(snippet, &e, values, cursors);
+	e.out[e.len] = '\0';
+
+	free_wildcard_values(values);
+	return e.out;
+}
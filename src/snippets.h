@@ -0,0 +1,44 @@
+/*
+ *      snippets.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GEANY_SNIPPETS_H
+#define GEANY_SNIPPETS_H 1
+
+#include "editor.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct Snippet Snippet;
+
+
+Snippet *snippet_compile(const gchar *text, GHashTable *specials);
+
+Snippet *snippet_compile_text_block(const gchar *text, gint cursor_index, const gchar *newline);
+
+void snippet_free(Snippet *snippet);
+
+gchar *snippet_expand(const Snippet *snippet, GeanyEditor *editor, gint newline_indent_size,
+		GArray *cursors);
+
+G_END_DECLS
+
+#endif /* GEANY_SNIPPETS_H */
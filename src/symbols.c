@@ -2011,8 +2011,7 @@ static gboolean goto_tag(const gchar *name, gboolean definition)
 	NavPosition old_npos = nav_get_current_position(old_doc);
 	g_return_val_if_fail(DOC_VALID(old_doc), FALSE);
 	gboolean found = FALSE;
-	const GPtrArray *all_tags;
-	GPtrArray *tags, *filtered_tags;
+	GPtrArray *all_tags, *tags, *filtered_tags;
 	guint i;
 	guint current_line = sci_get_current_line(old_doc->editor->sci) + 1;
 
@@ -2029,6 +2028,7 @@ static gboolean goto_tag(const gchar *name, gboolean definition)
 				current_tag = tmtag;
 		}
 	}
+	g_ptr_array_free(all_tags, TRUE);
 
 	if (current_tag)
 		/* swap definition/declaration search */
@@ -64,8 +64,25 @@ static TMTagType TM_GLOBAL_TYPE_MASK =
 	tm_tag_class_t | tm_tag_enum_t | tm_tag_interface_t |
 	tm_tag_struct_t | tm_tag_typedef_t | tm_tag_union_t | tm_tag_namespace_t;
 
+/* number of recent tm_workspace_find() results kept */
+#define FIND_CACHE_SIZE 16
+
+typedef struct
+{
+	char *name;
+	char *scope;
+	TMTagType type;
+	TMParserType lang;
+	GPtrArray *tags;
+} FindCacheEntry;
+
 static TMWorkspace *theWorkspace = NULL;
 
+/* most recently used first, valid while find_cache_generation is the workspace generation */
+static FindCacheEntry find_cache[FIND_CACHE_SIZE];
+static guint find_cache_len = 0;
+static guint find_cache_generation = 0;
+
 static gboolean tm_create_workspace(void)
 {
 	theWorkspace = g_new(TMWorkspace, 1);
@@ -75,6 +92,7 @@ static gboolean tm_create_workspace(void)
 	theWorkspace->source_files = g_ptr_array_new();
 	theWorkspace->typename_array = g_ptr_array_new();
 	theWorkspace->global_typename_array = g_ptr_array_new();
+	theWorkspace->generation = 0;
 
 	tm_ctags_init();
 	tm_parser_verify_type_mappings();
@@ -82,6 +100,29 @@ static gboolean tm_create_workspace(void)
 	return TRUE;
 }
 
+static void free_find_cache_entry(FindCacheEntry *entry)
+{
+	g_free(entry->name);
+	g_free(entry->scope);
+	g_ptr_array_free(entry->tags, TRUE);
+}
+
+static void clear_find_cache(void)
+{
+	guint i;
+
+	for (i = 0; i < find_cache_len; i++)
+		free_find_cache_entry(&find_cache[i]);
+	find_cache_len = 0;
+}
+
+/* Called whenever tags are added, removed or freed, the cached lookup results may point
+ to freed tags after that */
+static void workspace_tags_changed(void)
+{
+	theWorkspace->generation++;
+}
+
 /* Frees the workspace structure and all child source files. Use only when
  exiting from the main program.
 */
@@ -100,6 +141,7 @@ void tm_workspace_free(void)
 	g_ptr_array_free(theWorkspace->tags_array, TRUE);
 	g_ptr_array_free(theWorkspace->typename_array, TRUE);
 	g_ptr_array_free(theWorkspace->global_typename_array, TRUE);
+	clear_find_cache();
 	g_free(theWorkspace);
 	theWorkspace = NULL;
 }
@@ -141,6 +183,9 @@ static void update_source_file(TMSourceFile *source_file, guchar* text_buf,
 	g_message("Source file updating based on source file %s", source_file->file_name);
 #endif
 
+	/* parsing frees the old tags, even when they are still in the workspace arrays */
+	workspace_tags_changed();
+
 	if (update_workspace)
 	{
 		/* tm_source_file_parse() deletes the tag objects - remove the tags from
@@ -204,6 +249,16 @@ void tm_workspace_update_source_file_buffer(TMSourceFile *source_file, guchar* t
 	update_source_file(source_file, text_buf, buf_size, TRUE, TRUE);
 }
 
+/* Like tm_workspace_update_source_file_buffer() but doesn't update the workspace tag
+ arrays, which makes updating many source files at once cheaper. Call tm_workspace_update()
+ when done, and don't use the workspace tags before that.
+*/
+void tm_workspace_update_source_file_buffer_noupdate(TMSourceFile *source_file,
+	guchar* text_buf, gsize buf_size)
+{
+	update_source_file(source_file, text_buf, buf_size, TRUE, FALSE);
+}
+
 /** Removes a source file from the workspace if it exists. This function also removes
  the tags belonging to this file from the workspace. To completely free the TMSourceFile
  pointer call tm_source_file_free() on it.
@@ -223,6 +278,7 @@ void tm_workspace_remove_source_file(TMSourceFile *source_file)
 			tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
 			tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
 			g_ptr_array_remove_index_fast(theWorkspace->source_files, i);
+			workspace_tags_changed();
 			return;
 		}
 	}
@@ -233,7 +289,7 @@ void tm_workspace_remove_source_file(TMSourceFile *source_file)
  which should be called before this function on source files which need to be
  reparsed.
 */
-static void tm_workspace_update(void)
+void tm_workspace_update(void)
 {
 	guint i, j;
 	TMSourceFile *source_file;
@@ -242,6 +298,8 @@ static void tm_workspace_update(void)
 	g_message("Recreating workspace tags array");
 #endif
 
+	workspace_tags_changed();
+
 	g_ptr_array_set_size(theWorkspace->tags_array, 0);
 
 #ifdef TM_DEBUG
@@ -347,6 +405,7 @@ gboolean tm_workspace_load_global_tags(const char *tags_file, TMParserType mode)
 	g_ptr_array_free(theWorkspace->global_tags, TRUE);
 	g_ptr_array_free(file_tags, TRUE);
 	theWorkspace->global_tags = new_tags;
+	workspace_tags_changed();
 
 	g_ptr_array_free(theWorkspace->global_typename_array, TRUE);
 	theWorkspace->global_typename_array = tm_tags_extract(new_tags, TM_GLOBAL_TYPE_MASK);
@@ -663,22 +722,75 @@ static void fill_find_tags_array(GPtrArray *dst, const GPtrArray *src,
 	}
 }
 
+/* Returns the cached tags matching the arguments, looking them up if they aren't cached.
+ The returned array is owned by the cache and only valid until the next lookup. */
+static const GPtrArray *find_cached_tags(const char *name, const char *scope, TMTagType type,
+	TMParserType lang)
+{
+	FindCacheEntry entry;
+	guint i;
+
+	if (find_cache_generation != theWorkspace->generation)
+	{
+		clear_find_cache();
+		find_cache_generation = theWorkspace->generation;
+	}
+
+	for (i = 0; i < find_cache_len; i++)
+	{
+		if (find_cache[i].type == type && find_cache[i].lang == lang &&
+			g_strcmp0(find_cache[i].name, name) == 0 &&
+			g_strcmp0(find_cache[i].scope, scope) == 0)
+			break;
+	}
+
+	if (i < find_cache_len)
+		entry = find_cache[i];
+	else
+	{
+		entry.name = g_strdup(name);
+		entry.scope = g_strdup(scope);
+		entry.type = type;
+		entry.lang = lang;
+		entry.tags = g_ptr_array_new();
+		fill_find_tags_array(entry.tags, theWorkspace->tags_array, name, scope, type, lang);
+		fill_find_tags_array(entry.tags, theWorkspace->global_tags, name, scope, type, lang);
+
+		/* drop the least recently used entry */
+		if (find_cache_len == FIND_CACHE_SIZE)
+			free_find_cache_entry(&find_cache[--find_cache_len]);
+		i = find_cache_len++;
+	}
+
+	/* move the entry to the front */
+	memmove(find_cache + 1, find_cache, i * sizeof(FindCacheEntry));
+	find_cache[0] = entry;
+
+	return entry.tags;
+}
+
 /* Returns all matching tags found in the workspace.
+ Recent results are cached until the workspace tags change, so that e.g. showing a calltip
+ again doesn't repeat the lookup.
  @param name The name of the tag to find.
  @param scope The scope name of the tag to find, or NULL.
  @param type The tag types to return (TMTagType). Can be a bitmask.
  @param attrs The attributes to sort and dedup on (0 terminated integer array).
  @param lang Specifies the language(see the table in parsers.h) of the tags to be found,
              -1 for all
- @return Array of matching tags.
+ @return Array of matching tags, to be freed by the caller.
 */
 GPtrArray *tm_workspace_find(const char *name, const char *scope, TMTagType type,
 	TMTagAttrType *attrs, TMParserType lang)
 {
-	GPtrArray *tags = g_ptr_array_new();
+	const GPtrArray *found = find_cached_tags(name, scope, type, lang);
+	GPtrArray *tags = g_ptr_array_sized_new(found->len);
 
-	fill_find_tags_array(tags, theWorkspace->tags_array, name, scope, type, lang);
-	fill_find_tags_array(tags, theWorkspace->global_tags, name, scope, type, lang);
+	if (found->len > 0)
+	{
+		g_ptr_array_set_size(tags, found->len);
+		memcpy(tags->pdata, found->pdata, found->len * sizeof(gpointer));
+	}
 
 	if (attrs)
 		tm_tags_sort(tags, attrs, TRUE, FALSE);
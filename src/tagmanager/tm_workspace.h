@@ -29,6 +29,7 @@ typedef struct TMWorkspace
 		(just pointers to source file tags, the tag objects are owned by the source files). @elementtype{TMTag} */
 	GPtrArray *typename_array; /* Typename tags for syntax highlighting (pointers owned by source files) */
 	GPtrArray *global_typename_array; /* Like above for global tags */
+	guint generation; /* Incremented whenever tags are added to or removed from the workspace */
 } TMWorkspace;
 
 void tm_workspace_add_source_file(TMSourceFile *source_file);
@@ -61,6 +62,11 @@ void tm_workspace_add_source_file_noupdate(TMSourceFile *source_file);
 void tm_workspace_update_source_file_buffer(TMSourceFile *source_file, guchar* text_buf,
 	gsize buf_size);
 
+void tm_workspace_update_source_file_buffer_noupdate(TMSourceFile *source_file,
+	guchar* text_buf, gsize buf_size);
+
+void tm_workspace_update(void);
+
 void tm_workspace_free(void);
 
 #ifdef TM_DEBUG
@@ -605,69 +605,168 @@ void tools_create_insert_custom_command_menu_items(void)
 	cc_insert_custom_command_items(menu_edit, _("Set Custom Commands"), NULL, -1);
 }
 
-/* (stolen from bluefish, thanks)
- * Returns number of characters, lines and words in the supplied gchar*.
- * Handles UTF-8 correctly. Input must be properly encoded UTF-8.
- * Words are defined as any characters grouped, separated with spaces. */
-static void word_count(gchar *text, guint *chars, guint *lines, guint *words)
+/* texts larger than this are counted in idle time slices, showing the progress */
+#define WORD_COUNT_IDLE_SIZE (16 * 1024 * 1024)
+#define WORD_COUNT_CHUNK_SIZE (1024 * 1024)
+/* time for counting per main loop iteration, in microseconds */
+#define WORD_COUNT_SLICE_USEC 20000
+
+enum
+{
+	WC_NEUTRAL,		/* neither starts nor ends a word */
+	WC_SEPARATOR,	/* ends a word */
+	WC_GRAPH		/* starts or continues a word */
+};
+
+typedef struct WordCount
 {
-	guint in_word = 0;
-	gunichar utext;
+	guint		chars;
+	guint		lines;
+	guint		words;
+	gboolean	in_word;
+}
+WordCount;
 
-	if (! text)
-		return; /* politely refuse to operate on NULL */
+typedef struct WordCountJob
+{
+	guint		 doc_id;
+	gint		 doc_length;	/* to notice if the document changed anyway */
+	gint		 start;			/* start of the text in the document */
+	gchar		*copy;			/* the text if it isn't contiguous in the document, or NULL */
+	gsize		 len;
+	gsize		 pos;			/* bytes counted so far */
+	gchar		*range;
+	WordCount	 count;
+	GtkWidget	*dialog;
+	GtkWidget	*progress;
+	guint		 source_id;
+}
+WordCountJob;
 
-	*chars = *words = *lines = 0;
-	while (*text != '\0')
+static guint8 ascii_classes[128];
+
+static void init_ascii_classes(void)
+{
+	guint c;
+
+	if (ascii_classes['a'] == WC_GRAPH)
+		return;
+
+	for (c = 0; c < G_N_ELEMENTS(ascii_classes); c++)
 	{
-		(*chars)++;
+		if (c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r' || c == ' ')
+			ascii_classes[c] = WC_SEPARATOR;
+		else if (g_ascii_isgraph(c))
+			ascii_classes[c] = WC_GRAPH;
+		else
+			ascii_classes[c] = WC_NEUTRAL;
+	}
+}
 
-		switch (*text)
+static inline void count_class(WordCount *count, guint class)
+{
+	if (class == WC_SEPARATOR)
+	{
+		count->words += count->in_word;
+		count->in_word = FALSE;
+	}
+	else if (class == WC_GRAPH)
+		count->in_word = TRUE;
+}
+
+/* (originally stolen from bluefish, thanks)
+ * Counts the characters, line breaks and words of the UTF-8 text of len bytes, continuing
+ * the given count. Words are defined as any characters grouped, separated with spaces.
+ * Runs of ASCII text are checked 8 bytes at a time and classified through a table, only
+ * multibyte characters are decoded. */
+static void word_count(const gchar *text, gsize len, WordCount *count)
+{
+	const guchar *p = (const guchar *) text;
+	const guchar *end = p + len;
+	WordCount c = *count;
+
+	while (p < end)
+	{
+		gunichar uc;
+		guint i;
+
+		if (end - p >= 8)
 		{
-			case '\n':
-				(*lines)++;
-			case '\r':
-			case '\f':
-			case '\t':
-			case ' ':
-			case '\v':
-				mb_word_separator:
-				if (in_word)
+			guint64 block;
+
+			memcpy(&block, p, sizeof block);
+			if ((block & G_GUINT64_CONSTANT(0x8080808080808080)) == 0)
+			{
+				for (i = 0; i < 8; i++)
 				{
-					in_word = 0;
-					(*words)++;
+					c.lines += p[i] == '\n';
+					count_class(&c, ascii_classes[p[i]]);
 				}
-				break;
-			default:
-				utext = g_utf8_get_char_validated(text, 2); /* This might be an utf-8 char */
-				if (g_unichar_isspace(utext)) /* Unicode encoded space? */
-					goto mb_word_separator;
-				if (g_unichar_isgraph(utext)) /* Is this something printable? */
-					in_word = 1;
-				break;
+				c.chars += 8;
+				p += 8;
+				continue;
+			}
 		}
-		/* Even if the current char is 2 bytes, this will iterate correctly. */
-		text = g_utf8_next_char(text);
+
+		c.chars++;
+		if (*p < 0x80)
+		{
+			c.lines += *p == '\n';
+			count_class(&c, ascii_classes[*p]);
+			p++;
+			continue;
+		}
+
+		uc = g_utf8_get_char_validated((const gchar *) p, end - p);
+		if (uc == (gunichar) -1 || uc == (gunichar) -2)
+		{
+			/* invalid bytes count as one character each */
+			p++;
+			continue;
+		}
+		if (g_unichar_isspace(uc))
+			count_class(&c, WC_SEPARATOR);
+		else if (g_unichar_isgraph(uc))
+			count_class(&c, WC_GRAPH);
+		p += g_utf8_skip[*p];
 	}
+	*count = c;
+}
 
+/* Adds the word at the end of the text and the first line to the count */
+static void word_count_finish(WordCount *count)
+{
 	/* Capture last word, if there's no whitespace at the end of the file. */
-	if (in_word)
-		(*words)++;
+	if (count->in_word)
+		count->words++;
+	count->in_word = FALSE;
 	/* We start counting line numbers from 1 */
-	if (*chars > 0)
-		(*lines)++;
+	if (count->chars > 0)
+		count->lines++;
 }
 
-void tools_word_count(void)
+static void attach_word_count_row(GtkWidget *table, guint row, const gchar *name,
+		const gchar *value)
 {
-	GtkWidget *dialog, *label, *vbox, *table;
-	GeanyDocument *doc;
-	guint chars = 0, lines = 0, words = 0;
-	gchar *text;
-	const gchar *range;
+	GtkWidget *label;
 
-	doc = document_get_current();
-	g_return_if_fail(doc != NULL);
+	label = gtk_label_new(name);
+	gtk_table_attach(GTK_TABLE(table), label, 0, 1, row, row + 1,
+					(GtkAttachOptions) (GTK_FILL),
+					(GtkAttachOptions) (0), 0, 0);
+	gtk_misc_set_alignment(GTK_MISC(label), 1, 0);
+
+	label = gtk_label_new(value);
+	gtk_table_attach(GTK_TABLE(table), label, 1, 2, row, row + 1,
+					(GtkAttachOptions) (GTK_FILL),
+					(GtkAttachOptions) (0), 20, 0);
+	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+}
+
+static void show_word_count_dialog(const gchar *range, const WordCount *count)
+{
+	GtkWidget *dialog, *vbox, *table;
+	gchar *text;
 
 	dialog = gtk_dialog_new_with_buttons(_("Word Count"), GTK_WINDOW(main_widgets.window),
 										 GTK_DIALOG_DESTROY_WITH_PARENT,
@@ -675,75 +774,22 @@ void tools_word_count(void)
 	vbox = ui_dialog_vbox_new(GTK_DIALOG(dialog));
 	gtk_widget_set_name(dialog, "GeanyDialog");
 
-	if (sci_has_selection(doc->editor->sci))
-	{
-		text = sci_get_selection_contents(doc->editor->sci);
-		range = _("selection");
-	}
-	else
-	{
-		text = sci_get_contents(doc->editor->sci, -1);
-		range = _("whole document");
-	}
-	word_count(text, &chars, &lines, &words);
-	g_free(text);
-
 	table = gtk_table_new(4, 2, FALSE);
 	gtk_table_set_row_spacings(GTK_TABLE(table), 5);
 	gtk_table_set_col_spacings(GTK_TABLE(table), 10);
 
-	label = gtk_label_new(_("Range:"));
-	gtk_table_attach(GTK_TABLE(table), label, 0, 1, 0, 1,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 0, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 1, 0);
-
-	label = gtk_label_new(range);
-	gtk_table_attach(GTK_TABLE(table), label, 1, 2, 0, 1,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 20, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	attach_word_count_row(table, 0, _("Range:"), range);
 
-	label = gtk_label_new(_("Lines:"));
-	gtk_table_attach(GTK_TABLE(table), label, 0, 1, 1, 2,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 0, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 1, 0);
-
-	text = g_strdup_printf("%d", lines);
-	label = gtk_label_new(text);
-	gtk_table_attach(GTK_TABLE(table), label, 1, 2, 1, 2,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 20, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	text = g_strdup_printf("%u", count->lines);
+	attach_word_count_row(table, 1, _("Lines:"), text);
 	g_free(text);
 
-	label = gtk_label_new(_("Words:"));
-	gtk_table_attach(GTK_TABLE(table), label, 0, 1, 2, 3,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 0, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 1, 0);
-
-	text = g_strdup_printf("%d", words);
-	label = gtk_label_new(text);
-	gtk_table_attach(GTK_TABLE(table), label, 1, 2, 2, 3,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 20, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	text = g_strdup_printf("%u", count->words);
+	attach_word_count_row(table, 2, _("Words:"), text);
 	g_free(text);
 
-	label = gtk_label_new(_("Characters:"));
-	gtk_table_attach(GTK_TABLE(table), label, 0, 1, 3, 4,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 0, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 1, 0);
-
-	text = g_strdup_printf("%d", chars);
-	label = gtk_label_new(text);
-	gtk_table_attach(GTK_TABLE(table), label, 1, 2, 3, 4,
-					(GtkAttachOptions) (GTK_FILL),
-					(GtkAttachOptions) (0), 20, 0);
-	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	text = g_strdup_printf("%u", count->chars);
+	attach_word_count_row(table, 3, _("Characters:"), text);
 	g_free(text);
 
 	gtk_container_add(GTK_CONTAINER(vbox), table);
@@ -754,6 +800,159 @@ void tools_word_count(void)
 	gtk_widget_show_all(dialog);
 }
 
+static void word_count_job_free(WordCountJob *job)
+{
+	if (job->source_id != 0)
+		g_source_remove(job->source_id);
+	gtk_widget_destroy(job->dialog);
+	g_free(job->copy);
+	g_free(job->range);
+	g_free(job);
+}
+
+static gboolean word_count_idle(gpointer user_data)
+{
+	WordCountJob *job = user_data;
+	GeanyDocument *doc = document_find_by_id(job->doc_id);
+	gint64 deadline = g_get_monotonic_time() + WORD_COUNT_SLICE_USEC;
+	const gchar *text;
+
+	/* the dialog is modal, but e.g. a reload could still change the text */
+	if (doc == NULL || sci_get_length(doc->editor->sci) != job->doc_length)
+	{
+		job->source_id = 0;
+		word_count_job_free(job);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* count in place, the gap of the buffer is at its end so this doesn't move any text */
+	text = job->copy != NULL ? job->copy : (const gchar *) scintilla_send_message(
+		doc->editor->sci, SCI_GETRANGEPOINTER, job->start, job->len);
+	do
+	{
+		gsize end = MIN(job->pos + WORD_COUNT_CHUNK_SIZE, job->len);
+
+		/* don't split a multibyte character */
+		while (end < job->len && (text[end] & 0xC0) == 0x80)
+			end++;
+		word_count(text + job->pos, end - job->pos, &job->count);
+		job->pos = end;
+	}
+	while (job->pos < job->len && g_get_monotonic_time() < deadline);
+
+	if (job->pos < job->len)
+	{
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(job->progress),
+			(gdouble) job->pos / job->len);
+		return G_SOURCE_CONTINUE;
+	}
+
+	job->source_id = 0;
+	word_count_finish(&job->count);
+	show_word_count_dialog(job->range, &job->count);
+	word_count_job_free(job);
+	return G_SOURCE_REMOVE;
+}
+
+static void on_word_count_response(G_GNUC_UNUSED GtkDialog *dialog, G_GNUC_UNUSED gint response,
+		WordCountJob *job)
+{
+	word_count_job_free(job);
+}
+
+/* Counts a large text in idle time slices without copying it. The progress dialog is modal,
+ * so the text can't be edited meanwhile. copy is the text if it isn't contiguous in the
+ * document, and is taken over. */
+static void start_word_count_job(GeanyDocument *doc, gint start, gsize len, gchar *copy,
+		const gchar *range)
+{
+	WordCountJob *job = g_new0(WordCountJob, 1);
+	GtkWidget *vbox, *label;
+
+	job->doc_id = doc->id;
+	job->doc_length = sci_get_length(doc->editor->sci);
+	job->start = start;
+	job->copy = copy;
+	job->len = len;
+	job->range = g_strdup(range);
+
+	job->dialog = gtk_dialog_new_with_buttons(_("Word Count"), GTK_WINDOW(main_widgets.window),
+		GTK_DIALOG_DESTROY_WITH_PARENT | GTK_DIALOG_MODAL,
+		GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL, NULL);
+	vbox = ui_dialog_vbox_new(GTK_DIALOG(job->dialog));
+	gtk_widget_set_name(job->dialog, "GeanyDialog");
+	label = gtk_label_new(_("Counting words..."));
+	gtk_misc_set_alignment(GTK_MISC(label), 0, 0.5);
+	gtk_box_pack_start(GTK_BOX(vbox), label, FALSE, FALSE, 0);
+	job->progress = gtk_progress_bar_new();
+	gtk_box_pack_start(GTK_BOX(vbox), job->progress, FALSE, FALSE, 0);
+
+	g_signal_connect(job->dialog, "response", G_CALLBACK(on_word_count_response), job);
+	g_signal_connect(job->dialog, "delete-event", G_CALLBACK(gtk_true), NULL);
+	gtk_widget_show_all(job->dialog);
+
+	job->source_id = g_idle_add(word_count_idle, job);
+}
+
+void tools_word_count(void)
+{
+	GeanyDocument *doc;
+	ScintillaObject *sci;
+	WordCount count = { 0, 0, 0, FALSE };
+	const gchar *range, *text;
+	gchar *copy = NULL;
+	gint start, end;
+	gsize len;
+
+	doc = document_get_current();
+	g_return_if_fail(doc != NULL);
+
+	sci = doc->editor->sci;
+	init_ascii_classes();
+
+	if (sci_has_selection(sci))
+	{
+		range = _("selection");
+		start = sci_get_selection_start(sci);
+		end = sci_get_selection_end(sci);
+	}
+	else
+	{
+		range = _("whole document");
+		start = 0;
+		end = sci_get_length(sci);
+	}
+
+	if (sci_has_selection(sci) && (sci_get_selection_mode(sci) != SC_SEL_STREAM ||
+		scintilla_send_message(sci, SCI_GETSELECTIONS, 0, 0) > 1))
+	{
+		/* rectangular and multiple selections aren't contiguous */
+		copy = sci_get_selection_contents(sci);
+		text = copy;
+		len = strlen(copy);
+	}
+	else
+	{
+		/* the gap is moved to the end, so later range pointers won't move the text */
+		sci_get_character_pointer(sci);
+		text = (const gchar *) scintilla_send_message(sci, SCI_GETRANGEPOINTER,
+			start, end - start);
+		len = end - start;
+	}
+
+	if (len > WORD_COUNT_IDLE_SIZE)
+	{
+		start_word_count_job(doc, start, len, copy, range);
+		return;
+	}
+
+	word_count(text, len, &count);
+	word_count_finish(&count);
+	g_free(copy);
+
+	show_word_count_dialog(range, &count);
+}
+
 /*
  * color dialog callbacks
  */
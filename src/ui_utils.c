@@ -64,7 +64,7 @@
 	"line: %l / %L\t "   \
 	"col: %c\t "         \
 	"sel: %s\t "         \
-	"%w      %t      %m" \
+	"%w      %t      %m%B" \
 	"mode: %M      "     \
 	"encoding: %e      " \
 	"filetype: %f      " \
@@ -363,6 +363,13 @@ static gchar *create_statusbar_statistics(GeanyDocument *doc,
 					g_string_append(stats_str, sp);
 				}
 				break;
+			case 'B':
+				if (doc->priv->large_file)
+				{
+					g_string_append(stats_str, _("LARGE"));	/* large file mode */
+					g_string_append(stats_str, sp);
+				}
+				break;
 			case 'M':
 				g_string_append(stats_str, utils_get_eol_short_name(sci_get_eol_mode(doc->editor->sci)));
 				break;
@@ -1140,9 +1147,14 @@ void ui_document_show_hide_real(GeanyDocument *doc)
 			GTK_CHECK_MENU_ITEM(ui_lookup_widget(main_widgets.window, "set_file_favorite1")),
 			document_get_favorite(doc));
 
+	item = ui_lookup_widget(main_widgets.window, "set_file_readonly1");
+	gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(item), doc->readonly);
+	/* a large file stays read-only until it's loaded completely */
+	ui_widget_set_sensitive(item, doc->priv->large_file_loader == NULL);
+
 	gtk_check_menu_item_set_active(
-			GTK_CHECK_MENU_ITEM(ui_lookup_widget(main_widgets.window, "set_file_readonly1")),
-			doc->readonly);
+			GTK_CHECK_MENU_ITEM(ui_lookup_widget(main_widgets.window, "set_file_large1")),
+			doc->priv->large_file);
 
 	item = ui_lookup_widget(main_widgets.window, "menu_write_unicode_bom1");
 	gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(item), doc->has_bom);
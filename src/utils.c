@@ -2127,3 +2127,14 @@ void utils_open_local_path(const gchar *path)
 
 	g_free(uri);
 }
+
+
+/* Number of processors available for worker threads; a guess on GLib < 2.36. */
+gint utils_get_num_processors(void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	return (gint) g_get_num_processors();
+#else
+	return 4;
+#endif
+}
@@ -0,0 +1,415 @@
+/*
+ *      wordindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Index of the words of a document, for document word completion.
+ *
+ * The words are counted in a hash table, and kept in a sorted array for prefix lookups.
+ * The index is built in idle time slices and then updated from the modification
+ * notifications: before a change the words of the affected lines are removed, and after it
+ * the words of the resulting lines are added again. The sorted array is only rebuilt when
+ * it's needed after large changes.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "wordindex.h"
+
+#include "editor.h"
+#include "sciwrappers.h"
+#include "utils.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+
+/* time for building the index per main loop iteration, in microseconds */
+#define BUILD_SLICE_USEC 8000
+#define BUILD_LINES_PER_STEP 1000
+/* changes larger than this rebuild the index in the background */
+#define MAX_UPDATE_LINES 5000
+#define MIN_WORD_LENGTH 2
+
+
+typedef struct WordEntry
+{
+	guint	count;		/* number of occurrences */
+	gchar	word[];
+}
+WordEntry;
+
+struct WordIndex
+{
+	ScintillaObject	*sci;
+	GHashTable		*words;			/* word -> WordEntry */
+	GPtrArray		*sorted;		/* the keys of words, sorted by strcmp() */
+	gboolean		 sorted_valid;
+	gboolean		 word_chars[128];
+	gchar			*word_chars_str;	/* SCI_GETWORDCHARS the index was built with */
+	gint			 built_lines;	/* the lines before this are indexed */
+	guint			 build_source;
+	/* lines whose words were removed before the current modification, -1 if none */
+	gint			 pending_line;
+};
+
+
+static gint compare_words(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const gchar * const *) a, *(const gchar * const *) b);
+}
+
+
+/* Returns the index of the first word in the sorted array not less than word */
+static guint lower_bound(WordIndex *index, const gchar *word)
+{
+	guint lo = 0, hi = index->sorted->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (strcmp(index->sorted->pdata[mid], word) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+static void add_word(WordIndex *index, const gchar *word, gsize len)
+{
+	gchar key[GEANY_MAX_WORD_LENGTH];
+	WordEntry *entry;
+
+	memcpy(key, word, len);
+	key[len] = '\0';
+	entry = g_hash_table_lookup(index->words, key);
+	if (entry != NULL)
+	{
+		entry->count++;
+		return;
+	}
+
+	entry = g_malloc(sizeof(WordEntry) + len + 1);
+	entry->count = 1;
+	memcpy(entry->word, key, len + 1);
+	g_hash_table_insert(index->words, entry->word, entry);
+
+	if (index->sorted_valid)
+	{
+		guint pos = lower_bound(index, entry->word);
+
+		g_ptr_array_add(index->sorted, NULL);
+		memmove(index->sorted->pdata + pos + 1, index->sorted->pdata + pos,
+			(index->sorted->len - pos - 1) * sizeof(gpointer));
+		index->sorted->pdata[pos] = entry->word;
+	}
+}
+
+
+static void remove_word(WordIndex *index, const gchar *word, gsize len)
+{
+	gchar key[GEANY_MAX_WORD_LENGTH];
+	WordEntry *entry;
+
+	memcpy(key, word, len);
+	key[len] = '\0';
+	entry = g_hash_table_lookup(index->words, key);
+	if (entry == NULL || --entry->count > 0)
+		return;
+
+	if (index->sorted_valid)
+		g_ptr_array_remove_index(index->sorted, lower_bound(index, key));
+	g_hash_table_remove(index->words, key);
+}
+
+
+/* Whether the character at p is part of a word, sets *len to its length in bytes */
+static inline gboolean is_word_char(WordIndex *index, const gchar *p, const gchar *end,
+		gsize *len)
+{
+	guchar c = *p;
+	gunichar uc;
+
+	if (c < 0x80)
+	{
+		*len = 1;
+		return index->word_chars[c];
+	}
+	/* like Scintilla, treat non-ASCII letters and digits as word characters */
+	uc = g_utf8_get_char_validated(p, end - p);
+	if (uc == (gunichar) -1 || uc == (gunichar) -2)
+	{
+		*len = 1;
+		return FALSE;
+	}
+	*len = g_utf8_skip[c];
+	return g_unichar_isalnum(uc) || g_unichar_ismark(uc) ||
+		g_unichar_type(uc) == G_UNICODE_CONNECT_PUNCTUATION;
+}
+
+
+/* Adds or removes the words of text */
+static void scan_text(WordIndex *index, const gchar *text, gsize text_len, gboolean add)
+{
+	const gchar *end = text + text_len;
+	const gchar *p = text;
+	gsize len;
+
+	while (p < end)
+	{
+		const gchar *start;
+
+		if (! is_word_char(index, p, end, &len))
+		{
+			p += len;
+			continue;
+		}
+		start = p;
+		do
+			p += len;
+		while (p < end && is_word_char(index, p, end, &len));
+
+		if (p - start >= MIN_WORD_LENGTH && p - start < GEANY_MAX_WORD_LENGTH)
+		{
+			if (add)
+				add_word(index, start, p - start);
+			else
+				remove_word(index, start, p - start);
+		}
+	}
+}
+
+
+static void scan_lines(WordIndex *index, gint first_line, gint last_line, gboolean add)
+{
+	gint start = sci_get_position_from_line(index->sci, first_line);
+	gint end = sci_get_line_end_position(index->sci, last_line);
+	const gchar *text;
+
+	if (end <= start)
+		return;
+
+	text = (const gchar *) scintilla_send_message(index->sci, SCI_GETRANGEPOINTER,
+		start, end - start);
+	scan_text(index, text, end - start, add);
+}
+
+
+static void read_word_chars(WordIndex *index)
+{
+	gchar chars[257];
+	gint i, n;
+
+	n = (gint) scintilla_send_message(index->sci, SCI_GETWORDCHARS, 0, (sptr_t) chars);
+	n = CLAMP(n, 0, 256);
+	chars[n] = '\0';
+
+	memset(index->word_chars, 0, sizeof(index->word_chars));
+	for (i = 0; i < n; i++)
+	{
+		if ((guchar) chars[i] < 0x80)
+			index->word_chars[(guchar) chars[i]] = TRUE;
+	}
+	g_free(index->word_chars_str);
+	index->word_chars_str = g_strndup(chars, n);
+}
+
+
+static gboolean build_idle(gpointer data)
+{
+	WordIndex *index = data;
+	gint64 deadline = g_get_monotonic_time() + BUILD_SLICE_USEC;
+	gint line_count = sci_get_line_count(index->sci);
+
+	do
+	{
+		gint last = MIN(index->built_lines + BUILD_LINES_PER_STEP, line_count) - 1;
+
+		scan_lines(index, index->built_lines, last, TRUE);
+		index->built_lines = last + 1;
+		if (index->built_lines >= line_count)
+		{
+			index->build_source = 0;
+			return G_SOURCE_REMOVE;
+		}
+	}
+	while (g_get_monotonic_time() < deadline);
+
+	return G_SOURCE_CONTINUE;
+}
+
+
+/* Empties the index and starts building it again */
+static void rebuild(WordIndex *index)
+{
+	g_hash_table_remove_all(index->words);
+	g_ptr_array_set_size(index->sorted, 0);
+	index->sorted_valid = FALSE;
+	index->built_lines = 0;
+	index->pending_line = -1;
+	read_word_chars(index);
+
+	if (index->build_source == 0)
+		index->build_source = g_idle_add(build_idle, index);
+}
+
+
+WordIndex *wordindex_new(ScintillaObject *sci)
+{
+	WordIndex *index = g_new0(WordIndex, 1);
+
+	index->sci = sci;
+	index->words = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+	index->sorted = g_ptr_array_new();
+	rebuild(index);
+	return index;
+}
+
+
+void wordindex_free(WordIndex *index)
+{
+	if (index == NULL)
+		return;
+
+	if (index->build_source != 0)
+		g_source_remove(index->build_source);
+	g_ptr_array_free(index->sorted, TRUE);
+	g_hash_table_destroy(index->words);
+	g_free(index->word_chars_str);
+	g_free(index);
+}
+
+
+/* Updates the index for an SCN_MODIFIED notification */
+void wordindex_update(WordIndex *index, const SCNotification *nt)
+{
+	ScintillaObject *sci = index->sci;
+	gint first, last;
+
+	if (nt->modificationType & (SC_MOD_BEFOREINSERT | SC_MOD_BEFOREDELETE))
+	{
+		first = sci_get_line_from_position(sci, nt->position);
+		last = (nt->modificationType & SC_MOD_BEFOREDELETE) ?
+			sci_get_line_from_position(sci, nt->position + nt->length) : first;
+
+		index->pending_line = -1;
+		/* lines not indexed yet are scanned later */
+		if (first >= index->built_lines)
+			return;
+		if (last >= index->built_lines || last - first > MAX_UPDATE_LINES)
+			rebuild(index);
+		else
+		{
+			scan_lines(index, first, last, FALSE);
+			index->pending_line = first;
+		}
+	}
+	else if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+	{
+		if (index->pending_line < 0)
+			return;
+
+		first = index->pending_line;
+		index->pending_line = -1;
+		index->built_lines += nt->linesAdded;
+		if (nt->linesAdded > MAX_UPDATE_LINES)
+			rebuild(index);
+		else
+			scan_lines(index, first, first + MAX(nt->linesAdded, 0), TRUE);
+	}
+}
+
+
+/* Whether the index is complete and up to date with the word characters of the document.
+ * Otherwise it's being built in the background. */
+gboolean wordindex_is_ready(WordIndex *index)
+{
+	gchar chars[257];
+	gint n;
+
+	n = (gint) scintilla_send_message(index->sci, SCI_GETWORDCHARS, 0, (sptr_t) chars);
+	n = CLAMP(n, 0, 256);
+	chars[n] = '\0';
+	/* the filetype has changed */
+	if (! utils_str_equal(chars, index->word_chars_str))
+		rebuild(index);
+
+	return index->build_source == 0;
+}
+
+
+/* Whether text only consists of word characters, so it can be looked up in the index */
+gboolean wordindex_is_word(WordIndex *index, const gchar *text)
+{
+	const gchar *end = text + strlen(text);
+	gsize len;
+
+	for (; text < end; text += len)
+	{
+		if (! is_word_char(index, text, end, &len))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+
+/* Adds copies of the words starting with prefix and longer than it to the words set, until it
+ * contains max_words words. exclude is the word being typed and skipped if it only occurs
+ * once. */
+void wordindex_find_prefix(WordIndex *index, const gchar *prefix, const gchar *exclude,
+		GHashTable *words, guint max_words)
+{
+	gsize prefix_len = strlen(prefix);
+	guint i;
+
+	if (! index->sorted_valid)
+	{
+		GHashTableIter iter;
+		gpointer key;
+
+		g_ptr_array_set_size(index->sorted, 0);
+		g_hash_table_iter_init(&iter, index->words);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
+			g_ptr_array_add(index->sorted, key);
+		qsort(index->sorted->pdata, index->sorted->len, sizeof(gpointer), compare_words);
+		index->sorted_valid = TRUE;
+	}
+
+	for (i = lower_bound(index, prefix);
+		i < index->sorted->len && g_hash_table_size(words) < max_words; i++)
+	{
+		const gchar *word = index->sorted->pdata[i];
+
+		if (strncmp(word, prefix, prefix_len) != 0)
+			break;
+		if (word[prefix_len] == '\0' || g_hash_table_lookup(words, word) != NULL)
+			continue;
+		if (exclude != NULL && strcmp(word, exclude) == 0 &&
+			((WordEntry *) g_hash_table_lookup(index->words, word))->count <= 1)
+		{
+			continue;
+		}
+		g_hash_table_insert(words, g_strdup(word), GUINT_TO_POINTER(TRUE));
+	}
+}